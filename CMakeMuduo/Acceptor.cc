@@ -1,12 +1,15 @@
 #include "Acceptor.h"
 #include "Logger.h"
 #include "InetAddress.h"
+#include "EventLoop.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
 
 static int createNonblockingOrDie()
 {
@@ -18,20 +21,38 @@ static int createNonblockingOrDie()
 	return sockfd;
 }
 
+//每次事件默认最多accept的连接数
+static const int kDefaultAcceptsPerEvent = 64;
+
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport):loop_(loop),acceptSocket_(createNonblockingOrDie()),
-	acceptChannel_(loop, acceptSocket_.fd()), listenning_(false)
+	acceptChannel_(loop, acceptSocket_.fd()), listenning_(false), maxAcceptsPerEvent_(kDefaultAcceptsPerEvent),
+	idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)), self_(std::make_shared<Acceptor*>(this))
 {
 	acceptSocket_.setReuseAddr(true);
 	acceptSocket_.setReusePort(reuseport);
 	acceptSocket_.bindAddress(listenAddr);
 
 	acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
+	acceptChannel_.setDescriber([this]() { return "Acceptor " + localAddress().toIpPort(); });
 }
 
 Acceptor::~Acceptor()
 {
 	acceptChannel_.disableAll();
 	acceptChannel_.remove();
+	::close(idleFd_);
+}
+
+InetAddress Acceptor::localAddress() const
+{
+	sockaddr_in local;
+	::memset(&local, 0, sizeof local);
+	socklen_t addrlen = sizeof local;
+	if (::getsockname(acceptSocket_.fd(), (sockaddr*)&local, &addrlen) < 0)
+	{
+		LOG_ERROR("%s:%s:%d getsockname error %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+	}
+	return InetAddress(local);
 }
 
 void Acceptor::listen()
@@ -44,26 +65,79 @@ void Acceptor::listen()
 //listenfd有事件发生，即有新用户连接
 void Acceptor::handleRead()
 {
-	InetAddress peerAddr;
-	int connfd = acceptSocket_.accept(&peerAddr);
-	if (connfd >= 0)
+	int accepted = 0;
+	while (accepted < maxAcceptsPerEvent_)
 	{
-		if (newConnectionCallback_)
+		InetAddress peerAddr;
+		int connfd = acceptSocket_.accept(&peerAddr);
+		if (connfd >= 0)
 		{
-			//轮询找到subloop，唤醒分发当前的新客户端channel
-			newConnectionCallback_(connfd, peerAddr);
+			if (newConnectionCallback_)
+			{
+				//轮询找到subloop，唤醒分发当前的新客户端channel
+				newConnectionCallback_(connfd, peerAddr);
+			}
+			else
+			{
+				::close(connfd);
+			}
+			++accepted;
 		}
-		else
+		else if (errno == EAGAIN)
 		{
-			::close(connfd);
+			return;
 		}
-	}
-	else
-	{
-		LOG_ERROR("%s:%s:%d accept error %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
-		if (errno = EMFILE)
+		else if (errno == EMFILE || errno == ENFILE)
 		{
+			//fd用完时accept不检查队列就返回EMFILE，只有腾出fd之后才知道还有没有连接
 			LOG_ERROR("%s:%s:%d sockfd reached limit\n", __FILE__, __FUNCTION__, __LINE__);
+			if (!dropConnection())
+			{
+				return;
+			}
+			++accepted;
+		}
+		else if (errno == ECONNABORTED || errno == EINTR || errno == EPROTO)
+		{
+			//对端在accept之前已经断开，继续下一个
+			continue;
 		}
+		else
+		{
+			LOG_ERROR("%s:%s:%d accept error %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+			return;
+		}
+	}
+
+	//边沿触发不会再通知，让loop先处理其他事件，下一轮继续accept
+	if (acceptChannel_.edgeTriggered())
+	{
+		loop_->queueInLoop(std::bind(&Acceptor::continueAccepting, std::weak_ptr<Acceptor*>(self_)));
+	}
+}
+
+//Acceptor只在loop线程中析构，和回调在同一个线程，不会在检查之后被析构
+void Acceptor::continueAccepting(const std::weak_ptr<Acceptor*>& self)
+{
+	std::shared_ptr<Acceptor*> acceptor = self.lock();
+	if (acceptor)
+	{
+		(*acceptor)->handleRead();
+	}
+}
+
+bool Acceptor::dropConnection()
+{
+	if (idleFd_ < 0)
+	{
+		return false;
 	}
-}
\ No newline at end of file
+	::close(idleFd_);
+	int connfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+	if (connfd >= 0)
+	{
+		::close(connfd);
+	}
+	idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+	return connfd >= 0;
+}
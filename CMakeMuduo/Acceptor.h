@@ -3,11 +3,12 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "InetAddress.h"
 
 #include <functional>
+#include <memory>
 
 class EventLoop;
-class InetAddress;
 
 class Acceptor:noncopyable
 {
@@ -20,8 +21,19 @@ public:
 	void setNewConnectionCallback(const NewConnectionCallback& cb) { newConnectionCallback_ = cb; }
 	bool listenning() const { return listenning_; }
 	void listen();
+	//listenfd使用边沿触发，每次事件一直accept到EAGAIN，需要在listen之前设置
+	void setEdgeTriggered(bool on) { acceptChannel_.setEdgeTriggered(on); }
+	//每次可读事件最多accept的连接数，水平触发剩下的由下一次事件处理，边沿触发放到下一轮继续
+	void setMaxAcceptsPerEvent(int n) { maxAcceptsPerEvent_ = n > 0 ? n : 1; }
+	int maxAcceptsPerEvent() const { return maxAcceptsPerEvent_; }
+	//实际绑定的地址，端口为0时由内核分配
+	InetAddress localAddress() const;
 private:
 	void handleRead();
+	//边沿触发时放到下一轮继续accept，Acceptor已经析构时什么也不做
+	static void continueAccepting(const std::weak_ptr<Acceptor*>& self);
+	//fd用完时拒绝一个连接，否则listenfd一直可读，loop会空转 队列里没有连接时返回false
+	bool dropConnection();
 	
 	//acceptor用的用户定义的baseloop,也称作mainloop
 	EventLoop* loop_;
@@ -29,4 +41,8 @@ private:
 	Channel acceptChannel_;
 	NewConnectionCallback newConnectionCallback_;
 	bool listenning_;
+	int maxAcceptsPerEvent_;
+	int idleFd_;	//预留的fd，进程fd用完时关掉它腾出位置，accept之后马上关闭连接
+	std::shared_ptr<Acceptor*> self_;	//放进loop的回调只持有它的weak_ptr，析构之后回调不会再访问this
+
 };
\ No newline at end of file
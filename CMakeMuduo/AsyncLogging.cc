@@ -0,0 +1,154 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+
+#include <chrono>
+#include <stdio.h>
+
+AsyncLogging::AsyncLogging(const std::string& basename, off_t rollSize, int flushInterval)
+	:flushInterval_(flushInterval),
+	running_(false),
+	basename_(basename),
+	rollSize_(rollSize),
+	thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
+	currentBuffer_(new LargeBuffer),
+	nextBuffer_(new LargeBuffer),
+	droppedBytes_(0)
+{
+	buffers_.reserve(kMaxPendingBuffers + 1);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+	if (running_)
+	{
+		stop();
+	}
+}
+
+void AsyncLogging::start()
+{
+	running_ = true;
+	thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+	if (!running_.exchange(false))
+	{
+		return;
+	}
+	{
+		//后端检查running_和开始等待都在锁内，加锁之后再通知不会丢失
+		std::unique_lock<std::mutex> lock(mutex_);
+		cond_.notify_one();
+	}
+	thread_.join();
+}
+
+void AsyncLogging::append(const char* logline, int len)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (currentBuffer_->avail() > len)
+	{
+		currentBuffer_->append(logline, len);
+		return;
+	}
+
+	buffers_.push_back(std::move(currentBuffer_));
+	if (nextBuffer_)
+	{
+		currentBuffer_ = std::move(nextBuffer_);
+	}
+	else if (buffers_.size() > kMaxPendingBuffers)
+	{
+		//后端跟不上，丢弃最旧的缓冲块并复用它
+		droppedBytes_ += buffers_.front()->length();
+		currentBuffer_ = std::move(buffers_.front());
+		currentBuffer_->reset();
+		buffers_.erase(buffers_.begin());
+	}
+	else
+	{
+		currentBuffer_.reset(new LargeBuffer);
+	}
+	currentBuffer_->append(logline, len);
+	cond_.notify_one();
+}
+
+//后端线程
+void AsyncLogging::threadFunc()
+{
+	LogFile output(basename_, rollSize_, flushInterval_);
+	BufferPtr newBuffer1(new LargeBuffer);
+	BufferPtr newBuffer2(new LargeBuffer);
+	BufferVector buffersToWrite;
+	buffersToWrite.reserve(kMaxPendingBuffers + 1);
+
+	while (running_)
+	{
+		size_t dropped = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			if (buffers_.empty())
+			{
+				cond_.wait_for(lock, std::chrono::seconds(flushInterval_), [this]() { return !buffers_.empty() || !running_; });
+			}
+			//当前缓冲块不管有没有写满都交给后端，换上一块空的
+			buffers_.push_back(std::move(currentBuffer_));
+			currentBuffer_ = std::move(newBuffer1);
+			buffersToWrite.swap(buffers_);
+			if (!nextBuffer_)
+			{
+				nextBuffer_ = std::move(newBuffer2);
+			}
+			dropped = droppedBytes_;
+			droppedBytes_ = 0;
+		}
+
+		if (dropped > 0)
+		{
+			char buf[256];
+			int len = snprintf(buf, sizeof buf, "AsyncLogging dropped %zu bytes of log messages, backend is too slow\n", dropped);
+			fputs(buf, stderr);
+			output.append(buf, len);
+		}
+
+		for (const BufferPtr& buffer : buffersToWrite)
+		{
+			output.append(buffer->data(), buffer->length());
+		}
+
+		//留下两块用来补充newBuffer1和newBuffer2，其余的释放
+		if (buffersToWrite.size() > 2)
+		{
+			buffersToWrite.resize(2);
+		}
+		if (!newBuffer1)
+		{
+			newBuffer1 = std::move(buffersToWrite.back());
+			buffersToWrite.pop_back();
+			newBuffer1->reset();
+		}
+		if (!newBuffer2 && !buffersToWrite.empty())
+		{
+			newBuffer2 = std::move(buffersToWrite.back());
+			buffersToWrite.pop_back();
+			newBuffer2->reset();
+		}
+		buffersToWrite.clear();
+		output.flush();
+	}
+
+	//退出前把剩下的日志写完
+	std::unique_lock<std::mutex> lock(mutex_);
+	buffers_.push_back(std::move(currentBuffer_));
+	for (const BufferPtr& buffer : buffers_)
+	{
+		output.append(buffer->data(), buffer->length());
+	}
+	//stop之后再调用append不会崩溃，只是不会再写入文件
+	currentBuffer_ = std::move(buffers_.back());
+	currentBuffer_->reset();
+	buffers_.clear();
+	output.flush();
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+#include "FixedBuffer.h"
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <sys/types.h>
+
+//异步日志 双缓冲
+//前端线程只把日志拷贝到当前4MB的缓冲块中，临界区只有一次memcpy，不做任何IO
+//后端线程定期(或者有缓冲块写满时)交换缓冲块，把整块写入滚动的日志文件
+//后端跟不上时丢弃最旧的缓冲块，保证日志突发时内存有上限，进程不会被拖垮
+//
+//使用方法:
+//	AsyncLogging log("server", 500 * 1024 * 1024);
+//	log.start();
+//	Logger::setOutput(std::bind(&AsyncLogging::append, &log, std::placeholders::_1, std::placeholders::_2));
+//	Logger::setFlush(std::bind(&AsyncLogging::stop, &log));	//LOG_FATAL在exit之前把还没写入的日志(包括FATAL这一行)写完
+class AsyncLogging :noncopyable
+{
+public:
+	AsyncLogging(const std::string& basename, off_t rollSize, int flushInterval = 3);
+	~AsyncLogging();
+
+	//前端接口，任意线程都可以调用
+	void append(const char* logline, int len);
+
+	void start();
+	//把所有还没写入的缓冲块写入文件并停止后端线程，可以重复调用，之后的append不再写入文件
+	void stop();
+private:
+	void threadFunc();
+
+	using LargeBuffer = FixedBuffer<kLargeBuffer>;
+	using BufferPtr = std::unique_ptr<LargeBuffer>;
+	using BufferVector = std::vector<BufferPtr>;
+
+	//等待写入的缓冲块超过这个数量时，开始丢弃最旧的
+	static const size_t kMaxPendingBuffers = 25;
+
+	const int flushInterval_;
+	std::atomic_bool running_;
+	const std::string basename_;
+	const off_t rollSize_;
+	Thread thread_;
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	BufferPtr currentBuffer_;	//当前正在写的缓冲块
+	BufferPtr nextBuffer_;		//备用的缓冲块
+	BufferVector buffers_;		//已经写满，等待后端写入文件的缓冲块
+	size_t droppedBytes_;		//因为后端跟不上而丢弃的日志字节数
+};
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "BackendPool.h"
+#include "Logger.h"
+#include "EventLoop.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+#include "Buffer.h"
+
+#include <deque>
+#include <future>
+#include <unordered_map>
+#include <stdint.h>
+#include <stdio.h>
+
+//一个到后端的连接 inflight按发送顺序保存还没有收到响应的请求的回调
+struct BackendPool::Backend
+{
+	std::unique_ptr<TcpClient> client;
+	TcpConnectionPtr conn;	//连接建立之后才有
+	std::deque<ResponseCallback> inflight;
+};
+
+//一个loop到一个后端地址的所有连接
+struct BackendPool::Group
+{
+	struct Waiting
+	{
+		std::string request;
+		ResponseCallback cb;
+	};
+
+	InetAddress addr;
+	std::vector<std::unique_ptr<Backend>> backends;
+	std::deque<Waiting> waiting;	//没有可用连接时排队的请求
+	size_t next;	//下一次从哪个连接开始找
+};
+
+struct BackendPool::LoopPool
+{
+	EventLoop* loop;
+	std::unordered_map<uint64_t, std::unique_ptr<Group>> groups;	//key为ip和端口
+};
+
+static uint64_t addressKey(const InetAddress& addr)
+{
+	const sockaddr_in* sa = addr.getSockAddr();
+	return (static_cast<uint64_t>(sa->sin_addr.s_addr) << 16) | sa->sin_port;
+}
+
+static void ignoreConnection(const TcpConnectionPtr&)
+{
+}
+
+static void discardMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+	buf->retrieveAll();
+}
+
+BackendPool::BackendPool(const std::vector<EventLoop*>& loops, const std::string& name, const ResponseParser& parser)
+	:name_(name), parser_(parser), connectionsPerLoop_(1), maxPipeline_(16), maxWaiting_(1024)
+{
+	for (EventLoop* loop : loops)
+	{
+		LoopPool* pool = new LoopPool;
+		pool->loop = loop;
+		loopPools_.push_back(pool);
+	}
+}
+
+BackendPool::~BackendPool()
+{
+	//连接和TcpClient都属于各自的loop，到loop中销毁
+	//TcpClient的回调绑定了this，要等每个loop都销毁完才能返回，否则之前收到的响应会访问已经析构的BackendPool
+	for (LoopPool* pool : loopPools_)
+	{
+		if (pool->loop->isInLoopThread())
+		{
+			destroyLoopPool(pool);
+			continue;
+		}
+		std::promise<void> done;
+		pool->loop->queueInLoop([pool, &done]() {
+			destroyLoopPool(pool);
+			done.set_value();
+		});
+		done.get_future().wait();
+	}
+}
+
+//连接的回调都指向这里的Backend和Group，先换掉再销毁，未完成的请求都失败
+void BackendPool::destroyLoopPool(LoopPool* pool)
+{
+	for (auto& item : pool->groups)
+	{
+		Group* group = item.second.get();
+		for (auto& backend : group->backends)
+		{
+			if (backend->conn)
+			{
+				backend->conn->setConnectionCallback(ignoreConnection);
+				backend->conn->setMessageCallback(discardMessage);
+				//只剩TcpClient持有连接，它析构时才会关闭连接
+				backend->conn.reset();
+			}
+		}
+		for (auto& backend : group->backends)
+		{
+			while (!backend->inflight.empty())
+			{
+				ResponseCallback cb(std::move(backend->inflight.front()));
+				backend->inflight.pop_front();
+				cb(false, StringPiece());
+			}
+		}
+		while (!group->waiting.empty())
+		{
+			ResponseCallback cb(std::move(group->waiting.front().cb));
+			group->waiting.pop_front();
+			cb(false, StringPiece());
+		}
+	}
+	delete pool;
+}
+
+BackendPool::LoopPool* BackendPool::currentLoopPool() const
+{
+	//loop个数很少，顺序查找
+	for (LoopPool* pool : loopPools_)
+	{
+		if (pool->loop->isInLoopThread())
+		{
+			return pool;
+		}
+	}
+	return nullptr;
+}
+
+BackendPool::Group* BackendPool::getGroup(LoopPool* pool, const InetAddress& addr)
+{
+	std::unique_ptr<Group>& group = pool->groups[addressKey(addr)];
+	if (group)
+	{
+		return group.get();
+	}
+
+	group.reset(new Group);
+	group->addr = addr;
+	group->next = 0;
+	for (int i = 0; i < connectionsPerLoop_; i++)
+	{
+		Backend* backend = new Backend;
+		group->backends.emplace_back(backend);
+
+		char buf[32];
+		snprintf(buf, sizeof buf, "-%d", i);
+		backend->client.reset(new TcpClient(pool->loop, addr, name_ + buf));
+		backend->client->setConnectionCallback(std::bind(&BackendPool::onConnection, this, group.get(), backend,
+			std::placeholders::_1));
+		backend->client->setMessageCallback(std::bind(&BackendPool::onMessage, this, group.get(), backend,
+			std::placeholders::_1, std::placeholders::_2));
+		backend->client->enableRetry();
+		backend->client->connect();
+	}
+	return group.get();
+}
+
+void BackendPool::warmUp(const InetAddress& addr)
+{
+	for (LoopPool* pool : loopPools_)
+	{
+		pool->loop->runInLoop(std::bind(&BackendPool::warmUpInLoop, this, pool, addr));
+	}
+}
+
+void BackendPool::warmUpInLoop(LoopPool* pool, const InetAddress& addr)
+{
+	getGroup(pool, addr);
+}
+
+void BackendPool::call(const InetAddress& addr, const StringPiece& request, const ResponseCallback& cb)
+{
+	LoopPool* pool = currentLoopPool();
+	if (pool == nullptr)
+	{
+		LOG_ERROR("BackendPool::call[%s] - not called in a pool loop\n", name_.c_str());
+		cb(false, StringPiece());
+		return;
+	}
+
+	Group* group = getGroup(pool, addr);
+	Backend* backend = group->waiting.empty() ? pickBackend(group) : nullptr;
+	if (backend != nullptr)
+	{
+		sendRequest(backend, request, cb);
+	}
+	else if (group->waiting.size() < maxWaiting_)
+	{
+		Group::Waiting waiting;
+		waiting.request = request.asString();
+		waiting.cb = cb;
+		group->waiting.push_back(std::move(waiting));
+	}
+	else
+	{
+		cb(false, StringPiece());
+	}
+}
+
+//已经连上且pipeline没满的连接中，未完成请求最少的那个，都不可用时返回nullptr
+BackendPool::Backend* BackendPool::pickBackend(Group* group)
+{
+	size_t n = group->backends.size();
+	Backend* best = nullptr;
+	for (size_t i = 0; i < n; i++)
+	{
+		Backend* backend = group->backends[(group->next + i) % n].get();
+		if (backend->conn && backend->inflight.size() < static_cast<size_t>(maxPipeline_)
+			&& (best == nullptr || backend->inflight.size() < best->inflight.size()))
+		{
+			best = backend;
+		}
+	}
+	group->next = (group->next + 1) % n;
+	return best;
+}
+
+void BackendPool::sendRequest(Backend* backend, const StringPiece& request, const ResponseCallback& cb)
+{
+	backend->inflight.push_back(cb);
+	backend->conn->send(request);
+}
+
+void BackendPool::flushWaiting(Group* group)
+{
+	while (!group->waiting.empty())
+	{
+		Backend* backend = pickBackend(group);
+		if (backend == nullptr)
+		{
+			break;
+		}
+		Group::Waiting waiting(std::move(group->waiting.front()));
+		group->waiting.pop_front();
+		sendRequest(backend, waiting.request, waiting.cb);
+	}
+}
+
+void BackendPool::onConnection(Group* group, Backend* backend, const TcpConnectionPtr& conn)
+{
+	if (conn->connected())
+	{
+		conn->setTcpNoDelay(true);
+		backend->conn = conn;
+		flushWaiting(group);
+	}
+	else
+	{
+		//已经发出的请求不知道后端有没有处理，不能重发，全部失败
+		backend->conn.reset();
+		std::deque<ResponseCallback> inflight;
+		inflight.swap(backend->inflight);
+		for (const ResponseCallback& cb : inflight)
+		{
+			cb(false, StringPiece());
+		}
+	}
+}
+
+void BackendPool::onMessage(Group* group, Backend* backend, const TcpConnectionPtr& conn, Buffer* buf)
+{
+	while (buf->readableBytes() > 0)
+	{
+		ssize_t n = parser_(buf);
+		if (n == 0)
+		{
+			break;
+		}
+		if (n < 0 || backend->inflight.empty())
+		{
+			LOG_ERROR("BackendPool::onMessage[%s] - bad response from %s\n", name_.c_str(),
+				group->addr.toIpPort().c_str());
+			buf->retrieveAll();
+			conn->forceClose();
+			return;
+		}
+
+		ResponseCallback cb(std::move(backend->inflight.front()));
+		backend->inflight.pop_front();
+		cb(true, StringPiece(buf->peek(), static_cast<size_t>(n)));
+		buf->retrieve(n);
+	}
+	flushWaiting(group);
+}
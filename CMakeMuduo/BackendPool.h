@@ -0,0 +1,68 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "StringPiece.h"
+#include "Callbacks.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class EventLoop;
+class Buffer;
+
+//到后端服务的连接池 每个loop对每个后端地址有自己的一组连接，只在这个loop的线程中使用，不加锁也不跨线程
+//同一个连接上可以有多个未完成的请求(pipelining)，后端按顺序返回响应，按FIFO和请求对应
+//协议由ResponseParser决定，连接池只负责切分响应
+//需要在loops停止之前析构，析构时等待每个loop销毁自己的连接
+class BackendPool :noncopyable
+{
+public:
+	//ok为false表示连接断开或者请求被拒绝，此时response为空
+	using ResponseCallback = std::function<void(bool ok, const StringPiece& response)>;
+	//buf开头有一个完整的响应时返回它的长度，不完整返回0，格式错误返回-1(关闭连接)
+	using ResponseParser = std::function<ssize_t(const Buffer*)>;
+
+	BackendPool(const std::vector<EventLoop*>& loops, const std::string& name, const ResponseParser& parser);
+	~BackendPool();
+
+	//下面的设置需要在第一次warmUp/call之前调用
+	//每个loop到每个后端地址的连接数
+	void setConnectionsPerLoop(int n) { connectionsPerLoop_ = n > 0 ? n : 1; }
+	//每个连接上最多未完成的请求数
+	void setMaxPipeline(int n) { maxPipeline_ = n > 0 ? n : 1; }
+	//所有连接都满了或者还没有连上时，最多排队的请求数，超过的请求直接失败
+	void setMaxWaiting(size_t n) { maxWaiting_ = n; }
+
+	//在所有loop上预先建立到addr的连接，可以在任意线程调用
+	void warmUp(const InetAddress& addr);
+	//只能在loops中的某个loop线程中调用，使用这个loop自己的连接，cb也在这个loop中执行
+	void call(const InetAddress& addr, const StringPiece& request, const ResponseCallback& cb);
+
+private:
+	struct Backend;
+	struct Group;
+	struct LoopPool;
+
+	LoopPool* currentLoopPool() const;
+	Group* getGroup(LoopPool* pool, const InetAddress& addr);
+	void warmUpInLoop(LoopPool* pool, const InetAddress& addr);
+	Backend* pickBackend(Group* group);
+	void sendRequest(Backend* backend, const StringPiece& request, const ResponseCallback& cb);
+	void flushWaiting(Group* group);
+
+	void onConnection(Group* group, Backend* backend, const TcpConnectionPtr& conn);
+	void onMessage(Group* group, Backend* backend, const TcpConnectionPtr& conn, Buffer* buf);
+
+	static void destroyLoopPool(LoopPool* pool);
+
+	const std::string name_;
+	ResponseParser parser_;
+	int connectionsPerLoop_;
+	int maxPipeline_;
+	size_t maxWaiting_;
+	std::vector<LoopPool*> loopPools_;	//构造之后不再修改，每个元素只在自己的loop中访问
+};
@@ -1,42 +1,166 @@
 #include "Buffer.h"
 
+#include <string.h>
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+//每个线程一块64k的溢出缓冲区，所有连接共用，线程启动时清零一次，之后读数据前不用再memset
+static __thread char t_extrabuf[65536];
+
+char Buffer::s_emptyStorage[Buffer::kCheapPrepend];
+
 //poller工作在LT模式
 ssize_t Buffer::readFd(int fd, int* savedErrno)
 {
-	//栈上分配64k内存
-	char extrabuf[65536] = { 0 };
+	//先按照最近的读取量预留空间，大部分数据直接读进buffer_，不用再从extrabuf拷贝
+	//减去kCheapPrepend，新分配的块正好是readHint_大小
+	ensureWritableBytes(readHint_ - kCheapPrepend);
+
 	struct iovec vec[2];
 	const size_t writable = writableBytes();
 	vec[0].iov_base = begin()+writerIndex_;
 	vec[0].iov_len = writable;
 
-	vec[1].iov_base = extrabuf;
-	vec[1].iov_len = sizeof extrabuf;
+	vec[1].iov_base = t_extrabuf;
+	vec[1].iov_len = sizeof t_extrabuf;
 
 	//如果当前buffer大小已经超过64k，不再使用extrabuf
-	const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+	const int iovcnt = (writable < sizeof(t_extrabuf)) ? 2 : 1;
 	const ssize_t n = ::readv(fd, vec, iovcnt);
 
 	if (n < 0)
 	{
 		*savedErrno = errno;
 	}
-	else if(n<=writable)	//没用到extrabuf
+	else if(static_cast<size_t>(n)<=writable)	//没用到extrabuf
 	{
 		writerIndex_ += n;
 	}
 	else
 	{
-		writerIndex_ = buffer_.size();
-		append(extrabuf, n-writable);
+		writerIndex_ = capacity_;
+		append(t_extrabuf, n-writable);
+	}
+	if (n > 0)
+	{
+		adjustReadHint(n);
 	}
 	return n;
 }
 
+ssize_t Buffer::readFdUntilBlocked(int fd, size_t maxBytes, int* savedErrno)
+{
+	size_t total = 0;
+	while (total < maxBytes)
+	{
+		ssize_t n = readFd(fd, savedErrno);
+		if (n < 0 && *savedErrno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			if (total > 0)
+			{
+				//EOF或者错误留给下一次调用报告
+				if (n == 0)
+				{
+					*savedErrno = 0;
+				}
+				return total;
+			}
+			return n;
+		}
+		total += n;
+	}
+	*savedErrno = 0;	//读满了maxBytes，内核缓冲区里可能还有数据
+	return total;
+}
+
+//读满了预留的空间就加倍，连续两次不到一半就减半
+void Buffer::adjustReadHint(size_t n)
+{
+	if (n >= readHint_)
+	{
+		smallReads_ = 0;
+		while (readHint_ < n && readHint_ < kMaxReadHint)
+		{
+			readHint_ *= 2;
+		}
+	}
+	else if (n <= readHint_ / 2 && readHint_ > kMinReadHint)
+	{
+		if (++smallReads_ >= 2)
+		{
+			readHint_ /= 2;
+			smallReads_ = 0;
+		}
+	}
+	else
+	{
+		smallReads_ = 0;
+	}
+}
+
+void Buffer::makeSpace(size_t len)
+{
+	size_t readable = readableBytes();
+	if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+	{
+		//换一块更大的存储，至少翻倍，避免连续append时反复拷贝
+		size_t size = std::max(kCheapPrepend + readable + len, capacity_ * 2);
+		size_t capacity = 0;
+		char* block = BufferPool::allocate(size, &capacity);
+		memcpy(block + kCheapPrepend, peek(), readable);
+		releaseStorage();
+		buffer_ = block;
+		capacity_ = capacity;
+	}
+	else
+	{
+		//前面已经读走的空间够用，把数据挪到开头
+		std::copy(begin() + readerIndex_, begin() + writerIndex_, begin() + kCheapPrepend);
+	}
+	readerIndex_ = kCheapPrepend;
+	writerIndex_ = readerIndex_ + readable;
+}
+
+void Buffer::shrink()
+{
+	size_t readable = readableBytes();
+	if (readable == 0)
+	{
+		readerIndex_ = writerIndex_ = kCheapPrepend;
+		releaseStorage();
+		return;
+	}
+
+	size_t capacity = 0;
+	char* block = BufferPool::allocate(kCheapPrepend + readable, &capacity);
+	if (capacity >= capacity_)
+	{
+		BufferPool::deallocate(block, capacity);
+		return;
+	}
+	memcpy(block + kCheapPrepend, peek(), readable);
+	releaseStorage();
+	buffer_ = block;
+	capacity_ = capacity;
+	readerIndex_ = kCheapPrepend;
+	writerIndex_ = readerIndex_ + readable;
+}
+
+void Buffer::releaseStorage()
+{
+	if (buffer_ != s_emptyStorage)
+	{
+		BufferPool::deallocate(buffer_, capacity_);
+		buffer_ = s_emptyStorage;
+		capacity_ = kCheapPrepend;
+	}
+}
+
 ssize_t Buffer::writeFd(int fd, int* savedErrno)
 {
 	ssize_t n = ::write(fd, peek(), readableBytes());
@@ -45,4 +169,4 @@ ssize_t Buffer::writeFd(int fd, int* savedErrno)
 		*savedErrno = errno;
 	}
 	return n;
-}
\ No newline at end of file
+}
@@ -1,21 +1,46 @@
 #pragma once
 
-#include <vector>
+#include "noncopyable.h"
+#include "BufferPool.h"
+
 #include <unistd.h>
 #include <string>
+#include <algorithm>
 
 //网络库底层的缓冲区类型定义
-class Buffer
+//存储空间从本线程的BufferPool中按需分配，数据全部读完后还给内存池(见BufferPool::setRetainBytes)
+class Buffer :noncopyable
 {
 public:
 	static const size_t kCheapPrepend = 8;
 	static const size_t kInitialSize = 1024;
 
-	explicit Buffer(size_t initialSize=kInitialSize):buffer_(kCheapPrepend+initialSize),readerIndex_(kCheapPrepend),writerIndex_(kCheapPrepend)
+	//readFd每次至少预留的空间，根据最近几次读到的数据量调整
+	static const size_t kMinReadHint = 256;
+	static const size_t kMaxReadHint = 64 * 1024;
+
+	//构造时不分配内存，initialSize是第一次readFd预留的空间
+	explicit Buffer(size_t initialSize=kInitialSize):buffer_(s_emptyStorage),capacity_(kCheapPrepend),readerIndex_(kCheapPrepend),writerIndex_(kCheapPrepend),
+		readHint_(initialSize < kMinReadHint ? kMinReadHint : initialSize),smallReads_(0)
 	{}
+	~Buffer()
+	{
+		releaseStorage();
+	}
+
+	//只交换数据，readHint_属于读这个Buffer的连接，不交换
+	void swap(Buffer& rhs)
+	{
+		std::swap(buffer_, rhs.buffer_);
+		std::swap(capacity_, rhs.capacity_);
+		std::swap(readerIndex_, rhs.readerIndex_);
+		std::swap(writerIndex_, rhs.writerIndex_);
+	}
 
 	size_t readableBytes() const { return writerIndex_ - readerIndex_; }
-	size_t writableBytes() const { return buffer_.size() - writerIndex_; }
+	size_t writableBytes() const { return capacity_ - writerIndex_; }
+	//当前占用的存储空间 没有数据时可能为0
+	size_t capacity() const { return buffer_ == s_emptyStorage ? 0 : capacity_; }
 	size_t prependableBytes() const { return readerIndex_; }
 	//返回缓冲区中可读数据的起始地址
 	const char* peek() const { return begin() + readerIndex_; }
@@ -35,6 +60,11 @@ public:
 	void retrieveAll()
 	{
 		readerIndex_ = writerIndex_ = kCheapPrepend;
+		//数据读完了，超过保留大小的存储还给内存池
+		if (capacity_ > BufferPool::retainBytes())
+		{
+			releaseStorage();
+		}
 	}
 
 	//把onmessage上报的buffer数据，转成string返回
@@ -76,28 +106,38 @@ public:
 		return begin() + writerIndex_;
 	}
 
-	//从fd上读取数据
+	//直接写入beginWrite()之后，调用者自己移动写位置
+	void hasWritten(size_t len)
+	{
+		writerIndex_ += len;
+	}
+
+	//从fd上读取数据 只调用一次readv
 	ssize_t readFd(int fd, int* savedErrno);
+	//一直读到EAGAIN或者读满maxBytes字节，返回读到的总字节数
+	//读到了数据时，只有读空了内核缓冲区*savedErrno才是EAGAIN，否则还需要再调用一次
+	//(读满maxBytes，或者数据后面还有EOF、错误要报告)
+	ssize_t readFdUntilBlocked(int fd, size_t maxBytes, int* savedErrno);
+	size_t readHint() const { return readHint_; }
 	ssize_t writeFd(int fd, int* savedErrno);
+
+	//突发的大消息之后调用，没有数据时释放存储，否则换成刚好放得下剩余数据的块
+	void shrink();
 private:
-	char* begin() { return &*buffer_.begin(); }
-	const char* begin()const  { return &*buffer_.begin(); }
-	void makeSpace(size_t len)
-	{
-		if (writableBytes() + prependableBytes() < len + kCheapPrepend)
-		{
-			buffer_.resize(writerIndex_ + len);
-		}
-		else
-		{
-			size_t readable = readableBytes();
-			std::copy(begin() + readerIndex_, begin() + writerIndex_, begin() + kCheapPrepend);
-			readerIndex_ = kCheapPrepend;
-			writerIndex_ = readerIndex_ + readable;
-		}
-	}
+	void adjustReadHint(size_t n);
+	void makeSpace(size_t len);
+	void releaseStorage();
+
+	char* begin() { return buffer_; }
+	const char* begin()const  { return buffer_; }
+
+	//没有分配存储的Buffer都指向这块空间，writableBytes()为0，第一次写入时再从内存池分配
+	static char s_emptyStorage[kCheapPrepend];
 
-	std::vector<char> buffer_;
+	char* buffer_;
+	size_t capacity_;
 	size_t readerIndex_;
 	size_t writerIndex_;
+	size_t readHint_;
+	int smallReads_;	//连续读到的数据不到readHint_一半的次数
 };
\ No newline at end of file
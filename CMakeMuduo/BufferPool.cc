@@ -0,0 +1,133 @@
+#include "BufferPool.h"
+
+#include <atomic>
+#include <stdlib.h>
+#include <pthread.h>
+
+//256 512 ... 128k 一共10个级别
+static const int kNumClasses = 10;
+
+static std::atomic<size_t> s_maxCachedBytes(4 * 1024 * 1024);
+static std::atomic<size_t> s_retainBytes(0);
+
+//空闲块的前8个字节用来保存链表的next指针
+struct FreeBlock
+{
+	FreeBlock* next;
+};
+
+static __thread FreeBlock* t_freeLists[kNumClasses];
+static __thread size_t t_cachedBytes = 0;
+
+//线程退出时释放该线程缓存的空闲块
+static pthread_key_t s_trimKey;
+static pthread_once_t s_trimOnce = PTHREAD_ONCE_INIT;
+static __thread bool t_trimRegistered = false;
+
+static void trimAtThreadExit(void*)
+{
+	t_trimRegistered = false;
+	BufferPool::trim();
+}
+
+static void createTrimKey()
+{
+	::pthread_key_create(&s_trimKey, &trimAtThreadExit);
+}
+
+static void registerTrim()
+{
+	::pthread_once(&s_trimOnce, &createTrimKey);
+	::pthread_setspecific(s_trimKey, &t_trimRegistered);
+	t_trimRegistered = true;
+}
+
+//size所属的级别，超过kMaxBlockSize返回-1
+static int sizeClass(size_t size)
+{
+	if (size > BufferPool::kMaxBlockSize)
+	{
+		return -1;
+	}
+	int index = 0;
+	size_t blockSize = BufferPool::kMinBlockSize;
+	while (blockSize < size)
+	{
+		blockSize <<= 1;
+		index++;
+	}
+	return index;
+}
+
+char* BufferPool::allocate(size_t size, size_t* capacity)
+{
+	int index = sizeClass(size);
+	if (index < 0)
+	{
+		*capacity = size;
+		return static_cast<char*>(::malloc(size));
+	}
+
+	*capacity = kMinBlockSize << index;
+	FreeBlock* block = t_freeLists[index];
+	if (block)
+	{
+		t_freeLists[index] = block->next;
+		t_cachedBytes -= *capacity;
+		return reinterpret_cast<char*>(block);
+	}
+	return static_cast<char*>(::malloc(*capacity));
+}
+
+void BufferPool::deallocate(char* block, size_t capacity)
+{
+	int index = sizeClass(capacity);
+	if (index < 0 || t_cachedBytes + capacity > s_maxCachedBytes.load(std::memory_order_relaxed))
+	{
+		::free(block);
+		return;
+	}
+
+	if (!t_trimRegistered)
+	{
+		registerTrim();
+	}
+	FreeBlock* node = reinterpret_cast<FreeBlock*>(block);
+	node->next = t_freeLists[index];
+	t_freeLists[index] = node;
+	t_cachedBytes += capacity;
+}
+
+size_t BufferPool::cachedBytes()
+{
+	return t_cachedBytes;
+}
+
+void BufferPool::trim()
+{
+	for (int i = 0; i < kNumClasses; i++)
+	{
+		while (t_freeLists[i])
+		{
+			FreeBlock* next = t_freeLists[i]->next;
+			::free(t_freeLists[i]);
+			t_freeLists[i] = next;
+		}
+	}
+	t_cachedBytes = 0;
+}
+
+void BufferPool::setMaxCachedBytes(size_t bytes)
+{
+	s_maxCachedBytes.store(bytes, std::memory_order_relaxed);
+}
+
+void BufferPool::setRetainBytes(size_t bytes)
+{
+	s_retainBytes.store(bytes, std::memory_order_relaxed);
+}
+
+size_t BufferPool::retainBytes()
+{
+	return s_retainBytes.load(std::memory_order_relaxed);
+}
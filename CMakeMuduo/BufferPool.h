@@ -0,0 +1,33 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <stddef.h>
+
+//Buffer存储空间的内存池
+//按2的幂分成若干个大小级别，每个线程(也就是每个loop)为每个级别缓存一条空闲块的链表
+//分配和释放都只访问本线程的链表，不加锁；块本身是普通的malloc内存，可以在任意线程释放
+//超过kMaxBlockSize的大块不缓存，直接malloc/free
+class BufferPool :noncopyable
+{
+public:
+	static const size_t kMinBlockSize = 256;
+	static const size_t kMaxBlockSize = 128 * 1024;
+
+	//分配至少size字节的块，实际大小通过capacity返回
+	static char* allocate(size_t size, size_t* capacity);
+	//capacity必须是allocate返回的大小
+	static void deallocate(char* block, size_t capacity);
+
+	//本线程缓存的空闲块总字节数
+	static size_t cachedBytes();
+	//释放本线程缓存的所有空闲块
+	static void trim();
+
+	//每个线程最多缓存的空闲块字节数，超过的直接free 默认4M
+	static void setMaxCachedBytes(size_t bytes);
+	//Buffer的数据全部读完后，存储空间不超过bytes的留在Buffer里，超过的还给内存池
+	//默认0，空闲的连接不占用缓冲区内存
+	static void setRetainBytes(size_t bytes);
+	static size_t retainBytes();
+};
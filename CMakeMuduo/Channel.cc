@@ -1,8 +1,10 @@
 #include "Channel.h"
 #include "EventLoop.h"
 #include "Logger.h"
+#include "Tracer.h"
 
 #include <sys/epoll.h>
+#include <stdio.h>
 
 const int Channel::KNoneEvent = 0;
 const int Channel::KReadEvent = EPOLLIN | EPOLLPRI;
@@ -14,6 +16,7 @@ Channel::Channel(EventLoop* loop, int fd)
 	events_(0),
 	revents_(0),
 	index_(-1),
+	edgeTriggered_(false),
 	tied_(false)
 {}
 
@@ -28,6 +31,17 @@ void Channel::tie(const std::shared_ptr<void>& obj)
 	tied_ = true;
 }
 
+std::string Channel::description() const
+{
+	if (describer_)
+	{
+		return describer_();
+	}
+	char buf[32];
+	snprintf(buf, sizeof buf, "fd=%d", fd_);
+	return buf;
+}
+
 void Channel::update()
 {
 	loop_->updateChannel(this);
@@ -40,6 +54,8 @@ void Channel::remove()
 
 void Channel::handleEvent(Timestamp receiveTime)
 {
+	TraceScope trace("Channel::handleEvent", fd_);
+	trace.setResult(revents_);
 	if (tied_)
 	{
 		std::shared_ptr<void> guard = tie_.lock();
@@ -57,29 +73,43 @@ void Channel::handleEvent(Timestamp receiveTime)
 //根据poller通知的channel发生的具体事件，由channel调用回调函数
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-	LOG_INFO("channel handleEvent revents:%d\n", revents_);
+	LOG_DEBUG("channel handleEvent revents:%d\n", revents_);
 
+	//每个回调前后记录时间，超过StallDetector的预算时报告
 	if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN))
 	{
-		if(closeCallback_)
+		if (closeCallback_)
+		{
+			StallGuard guard(loop_->stallWatch(), "close", this);
 			closeCallback_();
+		}
 	}
 
 	if (revents_ & EPOLLERR)
 	{
 		if (errorCallback_)
+		{
+			StallGuard guard(loop_->stallWatch(), "error", this);
 			errorCallback_();
+		}
 	}
 
 	if (revents_ & EPOLLIN)
 	{
 		if (readCallback_)
+		{
+			StallGuard guard(loop_->stallWatch(), "read", this);
 			readCallback_(receiveTime);
+		}
 	}
 
-	if (revents_ & EPOLLOUT)
+	//边沿触发模式下EPOLLOUT一直在注册，没有待发送数据时忽略
+	if ((revents_ & EPOLLOUT) && (events_ & KWriteEvent))
 	{
 		if (writeCallback_)
+		{
+			StallGuard guard(loop_->stallWatch(), "write", this);
 			writeCallback_();
+		}
 	}
 }
\ No newline at end of file
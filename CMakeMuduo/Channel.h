@@ -5,6 +5,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 
 class EventLoop;
@@ -31,6 +32,11 @@ public:
 	void setCloseCallback(EventCallback cb) { closeCallback_ = std::move(cb); }
 	void setErrorCallback(EventCallback cb) { errorCallback_ = std::move(cb); }
 
+	//描述这个channel属于谁，用于慢回调报告等诊断信息，只在需要时调用
+	void setDescriber(std::function<std::string()> cb) { describer_ = std::move(cb); }
+	//没有设置describer时是"fd=N"
+	std::string description() const;
+
 	//防止当channel被手动remove掉，channel还在执行回调
 	void tie(const std::shared_ptr<void>&);
 
@@ -41,9 +47,11 @@ public:
 
 	//update相当于epoll_ctl	设置fd相应的事件状态
 	void enableReading() { events_ |= KReadEvent; update(); }
-	void disableReading() { events_ &= KReadEvent; update(); }
-	void enableWriting() { events_ |= KReadEvent; update(); }
-	void disableWriting() { events_ &= ~KReadEvent; update(); }
+	void disableReading() { events_ &= ~KReadEvent; update(); }
+	//边沿触发模式下注册时总是带上EPOLLOUT，打开关闭写事件只改变events_，不需要epoll_ctl
+	//所以只能在写到EAGAIN之后再enableWriting，否则不会再收到可写通知
+	void enableWriting() { events_ |= KWriteEvent; if (!edgeTriggered_) update(); }
+	void disableWriting() { events_ &= ~KWriteEvent; if (!edgeTriggered_) update(); }
 	void disableAll() { events_ &= KNoneEvent; update(); }
 
 	//返回fd当前的事件状态
@@ -51,6 +59,11 @@ public:
 	bool isWriting() const { return events_ & KWriteEvent; }
 	bool isReading() const { return events_ & KReadEvent; }
 
+	//使用EPOLLET注册，需要在enableReading之前设置
+	//回调需要一直读写到EAGAIN，否则不会再收到通知
+	void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+	bool edgeTriggered() const { return edgeTriggered_; }
+
 	int index() { return index_; }
 	void set_index(int idx) { index_ = idx; }
 	
@@ -72,6 +85,7 @@ private:
 	int events_;	//注册fd感兴趣的事件
 	int revents_;	//poller返回的具体发生的事件
 	int index_;		//表示在Poller中的状态
+	bool edgeTriggered_;
 
 	std::weak_ptr<void> tie_;	
 	bool tied_;
@@ -81,4 +95,6 @@ private:
 	EventCallback writeCallback_;
 	EventCallback closeCallback_;
 	EventCallback errorCallback_;
+
+	std::function<std::string()> describer_;
 };
\ No newline at end of file
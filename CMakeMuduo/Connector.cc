@@ -0,0 +1,228 @@
+#include "Connector.h"
+#include "Logger.h"
+#include "Channel.h"
+#include "EventLoop.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+static int createNonblockingSocket()
+{
+	int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (sockfd < 0)
+	{
+		LOG_ERROR("%s:%s:%d socket create error %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+	}
+	return sockfd;
+}
+
+static int getSocketError(int sockfd)
+{
+	int optval;
+	socklen_t optlen = sizeof optval;
+	if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+	{
+		return errno;
+	}
+	return optval;
+}
+
+//连接本机时端口可能被分配成服务端口，和自己建立连接
+static bool isSelfConnect(int sockfd)
+{
+	sockaddr_in local;
+	sockaddr_in peer;
+	socklen_t len = sizeof local;
+	::memset(&local, 0, sizeof local);
+	::memset(&peer, 0, sizeof peer);
+	if (::getsockname(sockfd, (sockaddr*)&local, &len) < 0)
+	{
+		return false;
+	}
+	len = sizeof peer;
+	if (::getpeername(sockfd, (sockaddr*)&peer, &len) < 0)
+	{
+		return false;
+	}
+	return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
+	:loop_(loop), serverAddr_(serverAddr), connect_(false), state_(kDisconnected),
+	initRetryDelayMs_(kInitRetryDelayMs), maxRetryDelayMs_(kMaxRetryDelayMs), retryDelayMs_(kInitRetryDelayMs)
+{
+	LOG_DEBUG("Connector ctor[%p]\n", this);
+}
+
+Connector::~Connector()
+{
+	LOG_DEBUG("Connector dtor[%p]\n", this);
+}
+
+void Connector::start()
+{
+	connect_ = true;
+	retryDelayMs_ = initRetryDelayMs_;
+	loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::restart()
+{
+	setState(kDisconnected);
+	retryDelayMs_ = initRetryDelayMs_;
+	connect_ = true;
+	startInLoop();
+}
+
+void Connector::stop()
+{
+	connect_ = false;
+	loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+	//重试的定时器到期时可能已经stop了
+	if (connect_ && state_ == kDisconnected)
+	{
+		connect();
+	}
+}
+
+void Connector::stopInLoop()
+{
+	loop_->cancel(retryTimer_);
+	if (state_ == kConnecting)
+	{
+		setState(kDisconnected);
+		int sockfd = removeAndResetChannel();
+		retry(sockfd);	//connect_为false，只关闭sockfd
+	}
+}
+
+void Connector::connect()
+{
+	int sockfd = createNonblockingSocket();
+	if (sockfd < 0)
+	{
+		retry(sockfd);
+		return;
+	}
+	int ret = ::connect(sockfd, (sockaddr*)serverAddr_.getSockAddr(), sizeof(sockaddr_in));
+	int savedErrno = (ret == 0) ? 0 : errno;
+	switch (savedErrno)
+	{
+	case 0:
+	case EINPROGRESS:
+	case EINTR:
+	case EISCONN:
+		connecting(sockfd);
+		break;
+
+	//暂时性的错误，稍后重试
+	case EAGAIN:
+	case EADDRINUSE:
+	case EADDRNOTAVAIL:
+	case ECONNREFUSED:
+	case ENETUNREACH:
+	case ETIMEDOUT:
+		retry(sockfd);
+		break;
+
+	default:
+		LOG_ERROR("%s:%s:%d connect to %s error %d\n", __FILE__, __FUNCTION__, __LINE__,
+			serverAddr_.toIpPort().c_str(), savedErrno);
+		::close(sockfd);
+		setState(kDisconnected);
+		break;
+	}
+}
+
+//等待socket可写，可写时连接完成或者失败
+void Connector::connecting(int sockfd)
+{
+	setState(kConnecting);
+	channel_.reset(new Channel(loop_, sockfd));
+	channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+	channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+	channel_->enableWriting();
+}
+
+//channel不再需要了，返回sockfd
+int Connector::removeAndResetChannel()
+{
+	channel_->disableAll();
+	channel_->remove();
+	int sockfd = channel_->fd();
+	//现在可能还在Channel::handleEvent中，不能马上释放channel
+	loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+	return sockfd;
+}
+
+void Connector::resetChannel()
+{
+	channel_.reset();
+}
+
+void Connector::handleWrite()
+{
+	if (state_ != kConnecting)
+	{
+		return;
+	}
+
+	int sockfd = removeAndResetChannel();
+	int err = getSocketError(sockfd);
+	if (err != 0)
+	{
+		LOG_INFO("Connector::handleWrite - connect to %s error %d\n", serverAddr_.toIpPort().c_str(), err);
+		retry(sockfd);
+	}
+	else if (isSelfConnect(sockfd))
+	{
+		LOG_INFO("Connector::handleWrite - self connect\n");
+		retry(sockfd);
+	}
+	else
+	{
+		setState(kConnected);
+		if (connect_ && newConnectionCallback_)
+		{
+			newConnectionCallback_(sockfd);
+		}
+		else
+		{
+			::close(sockfd);
+		}
+	}
+}
+
+//Channel先处理EPOLLERR再处理EPOLLOUT，连接失败时在这里重试，disableAll之后不会再调用handleWrite
+void Connector::handleError()
+{
+	if (state_ == kConnecting)
+	{
+		int sockfd = removeAndResetChannel();
+		LOG_INFO("Connector::handleError - connect to %s error %d\n", serverAddr_.toIpPort().c_str(), getSocketError(sockfd));
+		retry(sockfd);
+	}
+}
+
+void Connector::retry(int sockfd)
+{
+	if (sockfd >= 0)
+	{
+		::close(sockfd);
+	}
+	setState(kDisconnected);
+	if (connect_)
+	{
+		LOG_INFO("Connector::retry - retry connecting to %s in %d milliseconds\n",
+			serverAddr_.toIpPort().c_str(), retryDelayMs_);
+		retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0, std::bind(&Connector::startInLoop, shared_from_this()));
+		retryDelayMs_ = retryDelayMs_ * 2 < maxRetryDelayMs_ ? retryDelayMs_ * 2 : maxRetryDelayMs_;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+class Channel;
+class EventLoop;
+
+//主动发起连接 非阻塞connect，由Channel的可写事件得到连接结果，失败后按指数退避重试
+//连接成功后把sockfd交给NewConnectionCallback，之后不再管理这个fd
+//只能在loop线程中使用，start/stop/restart可以在任意线程调用
+class Connector :noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+	using NewConnectionCallback = std::function<void(int sockfd)>;
+
+	Connector(EventLoop* loop, const InetAddress& serverAddr);
+	~Connector();
+
+	void setNewConnectionCallback(const NewConnectionCallback& cb) { newConnectionCallback_ = cb; }
+	//第一次重试等待initialMs毫秒，之后每次翻倍，最多maxMs毫秒，需要在start之前设置
+	void setRetryDelay(int initialMs, int maxMs) { initRetryDelayMs_ = initialMs; maxRetryDelayMs_ = maxMs; }
+
+	void start();
+	//连接断开之后重新连接，重试间隔恢复到初始值，只能在loop线程中调用
+	void restart();
+	void stop();
+
+	const InetAddress& serverAddress() const { return serverAddr_; }
+private:
+	enum States { kDisconnected, kConnecting, kConnected };
+	static const int kMaxRetryDelayMs = 30 * 1000;
+	static const int kInitRetryDelayMs = 500;
+
+	void setState(States s) { state_ = s; }
+	void startInLoop();
+	void stopInLoop();
+	void connect();
+	void connecting(int sockfd);
+	void handleWrite();
+	void handleError();
+	void retry(int sockfd);
+	int removeAndResetChannel();
+	void resetChannel();
+
+	EventLoop* loop_;
+	InetAddress serverAddr_;
+	std::atomic_bool connect_;	//stop之后为false，不再重试
+	std::atomic_int state_;
+	std::unique_ptr<Channel> channel_;	//只在connect进行中存在
+	NewConnectionCallback newConnectionCallback_;
+	int initRetryDelayMs_;
+	int maxRetryDelayMs_;
+	int retryDelayMs_;
+	TimerId retryTimer_;
+};
+
+using ConnectorPtr = std::shared_ptr<Connector>;
@@ -0,0 +1,154 @@
+#include "CpuAffinity.h"
+#include "Logger.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+//MPOL_LOCAL在linux/mempolicy.h中定义，不依赖libnuma
+static const int kMpolLocal = 4;
+
+//line中是否有完整的网卡名ifname，前面是空白，后面是'-'、':'或者行尾
+//只用strstr的话eth1也会匹配eth10到eth19的中断
+static bool containsInterface(const char* line, const std::string& ifname)
+{
+	size_t n = ifname.size();
+	for (const char* p = strstr(line, ifname.c_str()); p != nullptr; p = strstr(p + 1, ifname.c_str()))
+	{
+		bool startOk = p == line || isspace(static_cast<unsigned char>(p[-1]));
+		char next = p[n];
+		bool endOk = next == '-' || next == ':' || next == '\0' || next == '\n' || next == '\r';
+		if (startOk && endOk)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+namespace CpuAffinity {
+	bool pinCurrentThread(int cpu)
+	{
+		if (cpu < 0 || cpu >= CPU_SETSIZE)
+		{
+			LOG_ERROR("%s:%s:%d invalid cpu %d\n", __FILE__, __FUNCTION__, __LINE__, cpu);
+			return false;
+		}
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+		if (ret != 0)
+		{
+			LOG_ERROR("%s:%s:%d pin thread to cpu %d error %d\n", __FILE__, __FUNCTION__, __LINE__, cpu, ret);
+			return false;
+		}
+		return true;
+	}
+
+	bool bindMemoryLocal()
+	{
+#ifdef SYS_set_mempolicy
+		if (::syscall(SYS_set_mempolicy, kMpolLocal, nullptr, 0) == 0)
+		{
+			return true;
+		}
+		//ENOSYS 内核没有打开NUMA
+		if (errno != ENOSYS)
+		{
+			LOG_ERROR("%s:%s:%d set_mempolicy error %d\n", __FILE__, __FUNCTION__, __LINE__, errno);
+		}
+#endif
+		return false;
+	}
+
+	std::vector<int> parseCpuList(const std::string& list)
+	{
+		std::vector<int> cpus;
+		const char* p = list.c_str();
+		while (*p != '\0')
+		{
+			char* end = nullptr;
+			long first = strtol(p, &end, 10);
+			if (end == p)
+			{
+				//跳过空白和换行
+				p++;
+				continue;
+			}
+			long last = first;
+			p = end;
+			if (*p == '-')
+			{
+				last = strtol(p + 1, &end, 10);
+				p = end;
+			}
+			for (long cpu = first; cpu <= last; cpu++)
+			{
+				cpus.push_back(static_cast<int>(cpu));
+			}
+			if (*p == ',')
+			{
+				p++;
+			}
+		}
+		return cpus;
+	}
+
+	std::vector<int> nicIrqCpus(const std::string& ifname)
+	{
+		std::vector<int> cpus;
+		FILE* interrupts = ::fopen("/proc/interrupts", "r");
+		if (interrupts == nullptr)
+		{
+			return cpus;
+		}
+		//cpu很多时一行会很长，用getline
+		char* line = nullptr;
+		size_t len = 0;
+		while (::getline(&line, &len, interrupts) > 0)
+		{
+			//" 45:   1234   0   IR-PCI-MSI  524288-edge  eth0-TxRx-0"
+			if (ifname.empty() || !containsInterface(line, ifname))
+			{
+				continue;
+			}
+			char* end = nullptr;
+			long irq = strtol(line, &end, 10);
+			if (end == line || *end != ':')
+			{
+				continue;
+			}
+
+			char path[64];
+			snprintf(path, sizeof path, "/proc/irq/%ld/smp_affinity_list", irq);
+			FILE* affinity = ::fopen(path, "r");
+			if (affinity == nullptr)
+			{
+				continue;
+			}
+			char list[1024];
+			if (::fgets(list, sizeof list, affinity))
+			{
+				for (int cpu : parseCpuList(list))
+				{
+					if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end())
+					{
+						cpus.push_back(cpu);
+					}
+				}
+			}
+			::fclose(affinity);
+		}
+		::free(line);
+		::fclose(interrupts);
+		return cpus;
+	}
+}
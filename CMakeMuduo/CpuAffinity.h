@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//线程绑核和NUMA相关的工具函数
+namespace CpuAffinity {
+	//把当前线程绑定到cpu上，失败返回false
+	bool pinCurrentThread(int cpu);
+
+	//当前线程之后分配的内存优先从所在cpu的NUMA节点上分配(MPOL_LOCAL)
+	//内核不支持NUMA时返回false，不影响使用
+	bool bindMemoryLocal();
+
+	//解析"0-3,8,10-11"格式的cpu列表，和/proc、/sys中的格式相同
+	std::vector<int> parseCpuList(const std::string& list);
+
+	//网卡ifname的中断所绑定的cpu，从/proc/interrupts找到名字是完整的ifname(后面是'-'、':'或者结束)的中断号，
+	//再读取/proc/irq/N/smp_affinity_list，按中断号顺序去重，找不到时返回空
+	std::vector<int> nicIrqCpus(const std::string& ifname);
+}
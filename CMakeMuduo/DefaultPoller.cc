@@ -1,5 +1,6 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "PollPoller.h"
 
 #include <stdlib.h>
 
@@ -7,7 +8,7 @@ Poller* Poller::newDefaultPoller(EventLoop* loop)
 {
 	if (::getenv("MUDUO_USE_POLL"))
 	{
-		return nullptr;	//生成poll的实例
+		return new PollPoller(loop);	//生成poll的实例
 	}
 	else
 	{
@@ -29,8 +29,7 @@ EPollPoller::~EPollPoller()
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
-	//实际上应该用LOG_DEBUG更合适
-	LOG_INFO("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
+	LOG_DEBUG("func=%s => fd total count:%lu\n", __FUNCTION__, channels_.size());
 
 	int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
 
@@ -39,7 +38,7 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 	
 	if (numEvents > 0)
 	{
-		LOG_INFO("%d events happened\n", numEvents);
+		LOG_DEBUG("%d events happened\n", numEvents);
 		fillActiveChannels(numEvents, activeChannels);
 		if (numEvents == events_.size())
 			events_.resize(events_.size() * 2);
@@ -69,7 +68,7 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 void EPollPoller::updateChannel(Channel* channel)
 {
 	const int index = channel->index();
-	LOG_INFO("func=%s => fd=%d events=%d index=%d \n",__FUNCTION__,channel->fd(), channel->events(), index);
+	LOG_DEBUG("func=%s => fd=%d events=%d index=%d \n",__FUNCTION__,channel->fd(), channel->events(), index);
 	if (index == kNew || index == kDeleted)
 	{
 		if (index == kNew)
@@ -100,7 +99,7 @@ void EPollPoller::removeChannel(Channel* channel)
 	int fd = channel->fd();
 	channels_.erase(fd);
 
-	LOG_INFO("func=%s => fd=%d \n", __FUNCTION__, channel->fd());
+	LOG_DEBUG("func=%s => fd=%d \n", __FUNCTION__, channel->fd());
 
 	int index = channel->index();
 	if (index == kAdded)
@@ -129,6 +128,11 @@ void EPollPoller::update(int operation, Channel* channel)
 	memset(&event, 0, sizeof(event));
 
 	event.events = channel->events();
+	//边沿触发的channel一直关注EPOLLOUT，由Channel根据events_决定是否回调
+	if (channel->edgeTriggered() && !channel->isNoneEvent())
+	{
+		event.events |= EPOLLET | EPOLLOUT;
+	}
 	event.data.fd = fd;
 	event.data.ptr = channel;
 
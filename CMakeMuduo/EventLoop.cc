@@ -2,6 +2,9 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
+#include "TimingWheel.h"
+#include "Tracer.h"
 
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -25,8 +28,10 @@ int createEventfd()
 	return evtfd;
 }
 
-EventLoop::EventLoop():looping_(false), quit_(false), callingPendingFunctors_(false), threadId_(CurrentThread::tid()),
-						poller_(Poller::newDefaultPoller(this)), wakeupFd_(createEventfd()), wakeupChannel_(new Channel(this, wakeupFd_))
+EventLoop::EventLoop():looping_(false), quit_(false), threadId_(CurrentThread::tid()),
+						poller_(Poller::newDefaultPoller(this)), timerQueue_(new TimerQueue(this)), wakeupFd_(createEventfd()),
+						wakeupChannel_(new Channel(this, wakeupFd_)), callingPendingFunctors_(false), wakeupPending_(false),
+						numConnections_(0)
 {
 	LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
 	if (t_loopInThisThread)
@@ -40,6 +45,7 @@ EventLoop::EventLoop():looping_(false), quit_(false), callingPendingFunctors_(fa
 
 	//设置wakeupfd的事件类型以及发生事件后的回调操作
 	wakeupChannel_->setReadCallback(std::bind(&EventLoop::handleRead, this));
+	wakeupChannel_->setDescriber([]() { return std::string("EventLoop wakeup"); });
 	//每一个Eventloop都将监听wakeupchannel的EPOLLIN读事件
 	wakeupChannel_->enableReading();
 }
@@ -76,8 +82,14 @@ void EventLoop::loop()
 	while (!quit_)
 	{
 		activeChannels_.clear();
-		//监听两类fd， 一种是clientfd 一种是wakeupfd
-		pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+		{
+			TraceScope trace("EventLoop::poll");
+			//监听两类fd， 一种是clientfd 一种是wakeupfd
+			pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+			trace.setResult(static_cast<int64_t>(activeChannels_.size()));
+		}
+		//忙碌时间用单调时钟计算，pollReturnTime_是系统时间，被调整时会算错
+		int64_t busyStart = Timestamp::monotonic().microSecondsSinceEpoch();
 		
 		for (Channel* channel : activeChannels_)
 		{
@@ -86,7 +98,10 @@ void EventLoop::loop()
 			channel->handleEvent(pollReturnTime_);
 		}
 		
-		doPendingFunctors();
+		size_t functors = doPendingFunctors();
+
+		int64_t busy = Timestamp::monotonic().microSecondsSinceEpoch() - busyStart;
+		metrics_.recordIteration(busy, activeChannels_.size(), functors);
 	}
 	LOG_INFO("EventLoop %p stop looping\n", this);
 	looping_ = false;
@@ -119,17 +134,22 @@ void EventLoop::runInLoop(Functor cb)
 //把cb放入队列中，唤醒loop所在的线程，执行cb
 void EventLoop::queueInLoop(Functor cb)
 {
-	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		pendingFunctors_.emplace_back(cb);
-	}
+	pendingFunctors_.push(std::move(cb));
 
 	//唤醒相应的需要执行上面回调操作的loop线程
 	//这里的callingPendingFunctors_表示正在执行回调，没阻塞在poll上,但是loop又有了新的回调，防止这一轮阻塞在poll上
+	//wakeupPending_为true说明之前已经唤醒过，loop在执行回调之前会先清除它，一定能看到这次push
+	bool woken = false;
 	if (!isInLoopThread() || callingPendingFunctors_)	
 	{
-		wakeup();
+		if (!wakeupPending_.exchange(true))
+		{
+			wakeup();
+			woken = true;
+		}
 	}
+	//记录在调用者的线程里
+	Tracer::instant("EventLoop::queueInLoop", woken);
 }
 
 
@@ -144,6 +164,37 @@ void EventLoop::wakeup()
 	}
 }
 
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+	return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+	Timestamp time(addTime(Timestamp::now(), delay));
+	return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+	Timestamp time(addTime(Timestamp::now(), interval));
+	return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+	timerQueue_->cancel(timerId);
+}
+
+TimingWheel* EventLoop::timingWheel()
+{
+	if (!timingWheel_)
+	{
+		timingWheel_.reset(new TimingWheel(this));
+	}
+	return timingWheel_.get();
+}
+
 //其实是调用的Poller的方法
 void EventLoop::updateChannel(Channel* channel)
 {
@@ -160,20 +211,28 @@ bool EventLoop::hasChannel(Channel* channel)
 	return poller_->hasChannel(channel);
 }
 
-void EventLoop::doPendingFunctors()
+size_t EventLoop::doPendingFunctors()
 {
-	std::vector<Functor> functors;
+	TraceScope trace("EventLoop::doPendingFunctors");
 	callingPendingFunctors_ = true;
+	//先清除标记再取回调，之后push的回调会重新唤醒loop
+	wakeupPending_.exchange(false);
 
+	//只执行当前已经在队列里的回调，执行过程中新加入的放到下一轮，避免一直重新入队的回调占住loop
+	Functor functor;
+	while (pendingFunctors_.pop(&functor))
 	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		functors.swap(pendingFunctors_);
+		runningFunctors_.push_back(std::move(functor));
 	}
-
-	for (const Functor& functor : functors)
+	for (const Functor& f : runningFunctors_)
 	{
-		functor();
+		StallGuard guard(&stallWatch_, "functor", &f);
+		f();
 	}
+	size_t count = runningFunctors_.size();
+	runningFunctors_.clear();
 
 	callingPendingFunctors_ = false;
+	trace.setResult(static_cast<int64_t>(count));
+	return count;
 }
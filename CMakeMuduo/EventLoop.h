@@ -5,14 +5,20 @@
 #include <atomic>
 #include <unistd.h>
 #include <memory>
-#include <mutex>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
+#include "MpscQueue.h"
+#include "LoopMetrics.h"
+#include "StallDetector.h"
 
 class Channel;
 class Poller;
+class TimerQueue;
+class TimingWheel;
 
 //事件循环类 主要包含了两个大模块 Channel和Poller（epoll）
 class EventLoop : noncopyable
@@ -33,24 +39,51 @@ public:
 	//在当前loop中执行cb
 	void runInLoop(Functor cb);
 	//把cb放入队列中，唤醒loop所在的线程，执行cb
+	//无锁，loop已经被唤醒还没有执行回调时不会重复写wakeupFd_
 	void queueInLoop(Functor cb);
 
 	//唤醒loop所在的线程
 	void wakeup();
 
+	//在time时刻执行cb
+	TimerId runAt(Timestamp time, TimerCallback cb);
+	//在delay秒之后执行cb
+	TimerId runAfter(double delay, TimerCallback cb);
+	//每隔interval秒执行一次cb
+	TimerId runEvery(double interval, TimerCallback cb);
+	//取消定时器
+	void cancel(TimerId timerId);
+
+	//空闲连接检测用的时间轮，第一次使用时创建，只能在loop线程中调用
+	TimingWheel* timingWheel();
+
 	//其实是调用的Poller的方法
 	void updateChannel(Channel* channel);
 	void removeChannel(Channel* channel);
 	bool hasChannel(Channel* channel);
 
+	//负载统计 任意线程都可以无锁读取，EventLoopThreadPool按它们选择subloop
+	//属于这个loop的TcpConnection对象个数，在TcpConnection构造和析构时修改
+	int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+	void addConnections(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
+	//从poll返回到执行完回调累计的时间，单位微秒
+	int64_t busyMicroSeconds() const { return metrics_.busyMicroSeconds(); }
+
+	//运行统计 任意线程都可以读取，只有loop线程可以写
+	LoopMetrics& metrics() { return metrics_; }
+	const LoopMetrics& metrics() const { return metrics_; }
+
+	//慢回调检测记录当前回调用的，只能在loop线程中使用
+	StallWatch* stallWatch() { return &stallWatch_; }
+
 	//判断eventloop对象是否在自己的线程里面
 	bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
 
 private:
 	//处理wakeup
 	void handleRead();
-	//执行mainloop注册的回调 处理mainloop分配的新的channel
-	void doPendingFunctors();
+	//执行mainloop注册的回调 处理mainloop分配的新的channel，返回执行的回调个数
+	size_t doPendingFunctors();
 
 	using ChannelList = std::vector<Channel*>;
 
@@ -60,6 +93,8 @@ private:
 	const pid_t threadId_;	//记录当前loop的所在线程id
 	Timestamp pollReturnTime_;	//poller返回发生事件的channels的时间点
 	std::unique_ptr<Poller> poller_;
+	std::unique_ptr<TimerQueue> timerQueue_;	//基于timerfd的定时器队列
+	std::unique_ptr<TimingWheel> timingWheel_;	//依赖timerQueue_，必须在它之后声明
 	
 	int wakeupFd_;	//当mainloop获取一个新用户的channel，通过轮询算法选择一个subloop，通过该成员唤醒subloop处理channel
 	std::unique_ptr<Channel> wakeupChannel_;
@@ -67,6 +102,11 @@ private:
 	ChannelList activeChannels_;
 
 	std::atomic_bool callingPendingFunctors_;	//标识当前loop是否有需要执行的回调操作
-	std::vector<Functor> pendingFunctors_;	//存储loop需要执行的所有回调操作
-	std::mutex mutex_;	//互斥锁用来保护上面vector的线程安全操作
+	MpscQueue<Functor> pendingFunctors_;	//存储loop需要执行的所有回调操作，其他线程无锁push
+	std::atomic_bool wakeupPending_;	//已经写过wakeupFd_，loop还没有开始执行回调
+	std::vector<Functor> runningFunctors_;	//本轮要执行的回调，复用内存
+
+	std::atomic_int numConnections_;
+	LoopMetrics metrics_;
+	StallWatch stallWatch_;
 };
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "CpuAffinity.h"
 
 
-EventLoopThread::EventLoopThread(const ThreadInitCallback& cb, const std::string& name):
+EventLoopThread::EventLoopThread(const ThreadInitCallback& cb, const std::string& name, int cpu):
 	loop_(nullptr), exiting_(false), thread_(std::bind(&EventLoopThread::threadFunc,this), name),
-	mutex_(), cond_(), callback_(cb)
+	mutex_(), cond_(), callback_(cb), cpu_(cpu)
 {
 }
 
@@ -40,6 +41,12 @@ EventLoop* EventLoopThread::startLoop()
 //下面这个方法，是在单独的新线程里面运行的
 void EventLoopThread::threadFunc()
 {
+	//在创建loop之前绑核，poller、buffer等都从本地节点分配
+	if (cpu_ >= 0 && CpuAffinity::pinCurrentThread(cpu_))
+	{
+		CpuAffinity::bindMemoryLocal();
+	}
+
 	EventLoop loop;	//创建一个独立的eventloop，和上面的线程是一一对应的 one loop per thread
 
 	if (callback_)
@@ -15,7 +15,8 @@ class EventLoopThread : noncopyable
 public:
 	using ThreadInitCallback = std::function<void(EventLoop*)>;
 
-	EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(), const std::string& name = std::string());
+	//cpu>=0时线程先绑定到这个cpu，并让之后的内存分配使用本地NUMA节点，再创建EventLoop
+	EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(), const std::string& name = std::string(), int cpu = -1);
 	~EventLoopThread();
 
 	EventLoop* startLoop();
@@ -28,4 +29,5 @@ private:
 	std::mutex mutex_;
 	std::condition_variable cond_;
 	ThreadInitCallback callback_;
+	int cpu_;
 };
\ No newline at end of file
@@ -1,10 +1,35 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+
+#include <algorithm>
+
+//kLeastLoad每隔多久重新计算一次各个loop的忙碌比例，单位微秒
+static const int64_t kLoadSampleInterval = 100 * 1000;
+//忙碌比例相差不到5%时认为一样忙，再比较连接数，避免同一个采样周期内的连接都落到一个loop上
+static const double kLoadTolerance = 0.05;
+//一致性哈希环上每个loop的虚拟节点数
+static const int kVirtualNodes = 160;
+
+//murmur3的fmix32，把输入打散到32位
+static uint32_t mixHash(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
 
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, const std::string& nameArg):baseLoop_(baseLoop), name_(nameArg),
-												started_(false), numThreads_(0), next_(0)
-{}
+												started_(false), numThreads_(0), next_(0),
+												placement_(kRoundRobin), randomState_(0)
+{
+	randomState_ = static_cast<uint32_t>(Timestamp::now().microSecondsSinceEpoch()) | 1;
+}
 
 EventLoopThreadPool::~EventLoopThreadPool()
 {
@@ -18,12 +43,21 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
 	{
 		char buf[name_.size() + 32];
 		snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-		EventLoopThread* t = new EventLoopThread(cb, buf);
+		int cpu = cpus_.empty() ? -1 : cpus_[i % cpus_.size()];
+		EventLoopThread* t = new EventLoopThread(cb, buf, cpu);
 		threads_.push_back(std::unique_ptr<EventLoopThread>(t));
 		//底层创建线程,绑定一个新的loop，并返回该loop的地址
 		loops_.push_back(t->startLoop());
 	}
 
+	int64_t now = Timestamp::monotonic().microSecondsSinceEpoch();
+	for (EventLoop* loop : loops_)
+	{
+		LoadSample sample = { now, loop->busyMicroSeconds(), 0.0 };
+		loadSamples_.push_back(sample);
+	}
+	buildHashRing();
+
 	//整个服务端只有一个线程运行着
 	if (numThreads_ == 0 && cb)
 	{
@@ -31,21 +65,142 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
 	}
 }
 
-//如果工作在多线程中，baseloop默认以轮询的方式分配channel给subloop
-EventLoop* EventLoopThreadPool::getNextLoop()
+//如果工作在多线程中，baseloop按placement_选择subloop
+EventLoop* EventLoopThreadPool::getNextLoop(size_t hashCode)
 {
-	EventLoop* loop = baseLoop_;
+	if (loops_.empty())
+	{
+		return baseLoop_;
+	}
 
-	if (!loops_.empty())
+	switch (placement_)
 	{
-		loop = loops_[next_];
-		next_++;
-		if (next_ >= loops_.size())
-			next_ = 0;
+	case kLeastConnections:
+		return getLeastConnectionsLoop();
+	case kLeastLoad:
+		return getLeastLoadLoop();
+	case kPowerOfTwoChoices:
+		return getPowerOfTwoChoicesLoop();
+	case kConsistentHash:
+		return getLoopForHash(hashCode);
+	default:
+		return getRoundRobinLoop();
 	}
+}
+
+EventLoop* EventLoopThreadPool::getRoundRobinLoop()
+{
+	EventLoop* loop = loops_[next_];
+	next_++;
+	if (next_ >= loops_.size())
+		next_ = 0;
 	return loop;
 }
 
+//从next_开始找，连接数相同的loop之间仍然是轮询
+EventLoop* EventLoopThreadPool::getLeastConnectionsLoop()
+{
+	size_t n = loops_.size();
+	size_t best = next_;
+	int bestConnections = loops_[best]->numConnections();
+	for (size_t i = 1; i < n && bestConnections > 0; i++)
+	{
+		size_t index = (next_ + i) % n;
+		int connections = loops_[index]->numConnections();
+		if (connections < bestConnections)
+		{
+			best = index;
+			bestConnections = connections;
+		}
+	}
+	next_ = static_cast<int>((best + 1) % n);
+	return loops_[best];
+}
+
+EventLoop* EventLoopThreadPool::getLeastLoadLoop()
+{
+	int64_t now = Timestamp::monotonic().microSecondsSinceEpoch();
+	size_t best = 0;
+	for (size_t i = 0; i < loops_.size(); i++)
+	{
+		LoadSample& sample = loadSamples_[i];
+		int64_t elapsed = now - sample.when;
+		if (elapsed >= kLoadSampleInterval)
+		{
+			int64_t busy = loops_[i]->busyMicroSeconds();
+			double load = static_cast<double>(busy - sample.busy) / elapsed;
+			//和上一个周期取平均，减少抖动
+			sample.load = (sample.load + std::min(load, 1.0)) / 2;
+			sample.when = now;
+			sample.busy = busy;
+		}
+
+		if (i > 0)
+		{
+			double diff = sample.load - loadSamples_[best].load;
+			if (diff < -kLoadTolerance
+				|| (diff < kLoadTolerance && loops_[i]->numConnections() < loops_[best]->numConnections()))
+			{
+				best = i;
+			}
+		}
+	}
+	return loops_[best];
+}
+
+EventLoop* EventLoopThreadPool::getPowerOfTwoChoicesLoop()
+{
+	size_t n = loops_.size();
+	if (n == 1)
+	{
+		return loops_[0];
+	}
+	size_t first = nextRandom() % n;
+	size_t second = nextRandom() % (n - 1);
+	if (second >= first)
+	{
+		second++;
+	}
+	EventLoop* a = loops_[first];
+	EventLoop* b = loops_[second];
+	return a->numConnections() <= b->numConnections() ? a : b;
+}
+
+EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode)
+{
+	uint32_t h = mixHash(static_cast<uint32_t>(hashCode ^ (static_cast<uint64_t>(hashCode) >> 32)));
+	auto it = std::lower_bound(hashRing_.begin(), hashRing_.end(), std::make_pair(h, static_cast<EventLoop*>(nullptr)));
+	if (it == hashRing_.end())
+	{
+		it = hashRing_.begin();
+	}
+	return it->second;
+}
+
+//每个loop在环上放kVirtualNodes个节点，loop个数变化时只有少部分客户端换loop
+void EventLoopThreadPool::buildHashRing()
+{
+	hashRing_.clear();
+	for (size_t i = 0; i < loops_.size(); i++)
+	{
+		for (int j = 0; j < kVirtualNodes; j++)
+		{
+			uint32_t h = mixHash(static_cast<uint32_t>(i) * 0x9e3779b9 + mixHash(static_cast<uint32_t>(j)));
+			hashRing_.push_back(std::make_pair(h, loops_[i]));
+		}
+	}
+	std::sort(hashRing_.begin(), hashRing_.end());
+}
+
+//xorshift32，只在baseloop中使用，不需要加锁
+uint32_t EventLoopThreadPool::nextRandom()
+{
+	randomState_ ^= randomState_ << 13;
+	randomState_ ^= randomState_ >> 17;
+	randomState_ ^= randomState_ << 5;
+	return randomState_;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
 {
 	if (loops_.empty())
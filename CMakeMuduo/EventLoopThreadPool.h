@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
+#include <stdint.h>
 
 class EventLoop;
 class EventLoopThread;
@@ -15,14 +17,29 @@ class EventLoopThreadPool:noncopyable
 public:
 	using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+	//新连接选择subloop的策略
+	enum Placement
+	{
+		kRoundRobin,		//轮询
+		kLeastConnections,	//TcpConnection最少的loop
+		kLeastLoad,			//最近一段时间忙碌比例最低的loop
+		kPowerOfTwoChoices,	//随机选两个，取连接少的那个
+		kConsistentHash,	//按hashCode在一致性哈希环上选，同一个客户端总是落到同一个loop
+	};
+
 	EventLoopThreadPool(EventLoop* baseLoop, const std::string& nameArg);
 	~EventLoopThreadPool();
 
 	void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+	void setPlacement(Placement placement) { placement_ = placement; }
+	//第i个subloop绑定到cpus[i % cpus.size()]，为空时不绑定，需要在start之前设置
+	void setCpuAffinity(const std::vector<int>& cpus) { cpus_ = cpus; }
+	Placement placement() const { return placement_; }
 	void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
-	//如果工作在多线程中，baseloop默认以轮询的方式分配channel给subloop
-	EventLoop* getNextLoop();
+	//如果工作在多线程中，baseloop按placement_选择subloop，只能在baseloop中调用
+	//hashCode只在kConsistentHash时使用，TcpServer传入对端ip的哈希值
+	EventLoop* getNextLoop(size_t hashCode = 0);
 
 	std::vector<EventLoop*> getAllLoops();
 
@@ -30,6 +47,22 @@ public:
 	const std::string& name() const{ return name_; }
 
 private:
+	//kLeastLoad用的采样，busy是上一次采样时loop的busyMicroSeconds
+	struct LoadSample
+	{
+		int64_t when;		//Timestamp::monotonic
+		int64_t busy;
+		double load;
+	};
+
+	EventLoop* getRoundRobinLoop();
+	EventLoop* getLeastConnectionsLoop();
+	EventLoop* getLeastLoadLoop();
+	EventLoop* getPowerOfTwoChoicesLoop();
+	EventLoop* getLoopForHash(size_t hashCode);
+	void buildHashRing();
+	uint32_t nextRandom();
+
 
 	EventLoop* baseLoop_;
 	std::string name_;
@@ -38,4 +71,10 @@ private:
 	int next_;
 	std::vector<std::unique_ptr<EventLoopThread>> threads_;
 	std::vector<EventLoop*> loops_;
+
+	std::vector<int> cpus_;
+	Placement placement_;
+	std::vector<LoadSample> loadSamples_;	//和loops_一一对应
+	std::vector<std::pair<uint32_t, EventLoop*>> hashRing_;	//按哈希值排序的虚拟节点
+	uint32_t randomState_;
 };
\ No newline at end of file
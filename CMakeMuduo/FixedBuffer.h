@@ -0,0 +1,44 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <string.h>
+
+//日志使用的定长缓冲区
+const int kSmallBuffer = 4000;
+const int kLargeBuffer = 4 * 1024 * 1024;
+
+template<int SIZE>
+class FixedBuffer :noncopyable
+{
+public:
+	FixedBuffer():cur_(data_) {}
+
+	//空间不够时直接丢弃，日志不允许阻塞或者扩容
+	void append(const char* buf, size_t len)
+	{
+		if (static_cast<size_t>(avail()) > len)
+		{
+			memcpy(cur_, buf, len);
+			cur_ += len;
+		}
+	}
+
+	const char* data() const { return data_; }
+	int length() const { return static_cast<int>(cur_ - data_); }
+
+	char* current() { return cur_; }
+	int avail() const { return static_cast<int>(end() - cur_); }
+	void add(size_t len) { cur_ += len; }
+
+	void reset() { cur_ = data_; }
+	void bzero() { memset(data_, 0, sizeof data_); }
+
+	std::string toString() const { return std::string(data_, length()); }
+private:
+	const char* end() const { return data_ + sizeof data_; }
+
+	char data_[SIZE];
+	char* cur_;
+};
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+
+//滚动日志文件 写满rollSize字节或者跨天之后换一个新文件
+//只在AsyncLogging的后端线程中使用，不是线程安全的
+class LogFile :noncopyable
+{
+public:
+	LogFile(const std::string& basename, off_t rollSize, int flushInterval = 3, int checkEveryN = 1024);
+	~LogFile();
+
+	void append(const char* logline, int len);
+	void flush();
+	bool rollFile();
+private:
+	//日志文件名 basename.20240101-120000.hostname.pid.log
+	static std::string getLogFileName(const std::string& basename, time_t* now);
+
+	const std::string basename_;
+	const off_t rollSize_;
+	const int flushInterval_;
+	const int checkEveryN_;
+
+	int count_;
+	off_t writtenBytes_;
+	time_t startOfPeriod_;	//当前文件所在的那一天
+	time_t lastRoll_;
+	time_t lastFlush_;
+
+	FILE* fp_;
+	char buffer_[64 * 1024];
+
+	static const int kRollPerSeconds_ = 60 * 60 * 24;
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "LogStream.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <algorithm>
+
+static const char digits[] = "9876543210123456789";
+static const char* zero = digits + 9;
+static const char digitsHex[] = "0123456789ABCDEF";
+
+//整数转字符串，负数取余也能通过zero查表
+template<typename T>
+static size_t convert(char buf[], T value)
+{
+	T i = value;
+	char* p = buf;
+
+	do
+	{
+		int lsd = static_cast<int>(i % 10);
+		i /= 10;
+		*p++ = zero[lsd];
+	} while (i != 0);
+
+	if (value < 0)
+	{
+		*p++ = '-';
+	}
+	*p = '\0';
+	std::reverse(buf, p);
+
+	return p - buf;
+}
+
+static size_t convertHex(char buf[], uintptr_t value)
+{
+	uintptr_t i = value;
+	char* p = buf;
+
+	do
+	{
+		int lsd = static_cast<int>(i % 16);
+		i /= 16;
+		*p++ = digitsHex[lsd];
+	} while (i != 0);
+
+	*p = '\0';
+	std::reverse(buf, p);
+
+	return p - buf;
+}
+
+template<typename T>
+void LogStream::formatInteger(T v)
+{
+	if (avail() > kMaxNumericSize)
+	{
+		size_t len = convert(buf_ + len_, v);
+		len_ += static_cast<int>(len);
+	}
+}
+
+LogStream& LogStream::operator<<(const void* p)
+{
+	uintptr_t v = reinterpret_cast<uintptr_t>(p);
+	if (avail() > kMaxNumericSize)
+	{
+		char* buf = buf_ + len_;
+		buf[0] = '0';
+		buf[1] = 'x';
+		size_t len = convertHex(buf + 2, v);
+		len_ += static_cast<int>(len + 2);
+	}
+	return *this;
+}
+
+LogStream& LogStream::operator<<(double v)
+{
+	if (avail() > kMaxNumericSize)
+	{
+		int len = snprintf(buf_ + len_, kMaxNumericSize, "%.12g", v);
+		len_ += len;
+	}
+	return *this;
+}
+
+template void LogStream::formatInteger(int);
+template void LogStream::formatInteger(unsigned int);
+template void LogStream::formatInteger(long);
+template void LogStream::formatInteger(unsigned long);
+template void LogStream::formatInteger(long long);
+template void LogStream::formatInteger(unsigned long long);
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <string.h>
+
+//流式日志的格式化 直接写入调用者提供的定长缓冲区，不分配堆内存
+//缓冲区写满之后的内容被丢弃
+class LogStream :noncopyable
+{
+public:
+	LogStream(char* buf, int capacity):buf_(buf), len_(0), capacity_(capacity) {}
+
+	LogStream& operator<<(bool v)
+	{
+		append(v ? "true" : "false", v ? 4 : 5);
+		return *this;
+	}
+	LogStream& operator<<(short v) { return *this << static_cast<int>(v); }
+	LogStream& operator<<(unsigned short v) { return *this << static_cast<unsigned int>(v); }
+	LogStream& operator<<(int v) { formatInteger(v); return *this; }
+	LogStream& operator<<(unsigned int v) { formatInteger(v); return *this; }
+	LogStream& operator<<(long v) { formatInteger(v); return *this; }
+	LogStream& operator<<(unsigned long v) { formatInteger(v); return *this; }
+	LogStream& operator<<(long long v) { formatInteger(v); return *this; }
+	LogStream& operator<<(unsigned long long v) { formatInteger(v); return *this; }
+
+	LogStream& operator<<(const void* p);
+	LogStream& operator<<(float v) { return *this << static_cast<double>(v); }
+	LogStream& operator<<(double v);
+
+	LogStream& operator<<(char v)
+	{
+		append(&v, 1);
+		return *this;
+	}
+	LogStream& operator<<(const char* str)
+	{
+		if (str)
+		{
+			append(str, static_cast<int>(strlen(str)));
+		}
+		else
+		{
+			append("(null)", 6);
+		}
+		return *this;
+	}
+	LogStream& operator<<(const std::string& str)
+	{
+		append(str.data(), static_cast<int>(str.size()));
+		return *this;
+	}
+
+	void append(const char* data, int len)
+	{
+		if (capacity_ - len_ > len)
+		{
+			memcpy(buf_ + len_, data, len);
+			len_ += len;
+		}
+	}
+
+	const char* data() const { return buf_; }
+	int length() const { return len_; }
+	int avail() const { return capacity_ - len_; }
+	void reset() { len_ = 0; }
+private:
+	template<typename T>
+	void formatInteger(T v);
+
+	static const int kMaxNumericSize = 48;
+
+	char* buf_;
+	int len_;
+	const int capacity_;
+};
\ No newline at end of file
@@ -1,50 +1,151 @@
-#include <iostream>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
 
 #include "Logger.h"
 #include "Timestamp.h"
+#include "FixedBuffer.h"
+
+static void defaultOutput(const char* msg, int len)
+{
+	::fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush()
+{
+	::fflush(stdout);
+}
+
+static Logger::OutputFunc g_output = defaultOutput;
+static Logger::FlushFunc g_flush = defaultFlush;
+
+std::atomic<int> Logger::s_logLevel_(INFO);
+
+//LOG_STREAMʽõֲֵ߳̾ʱд־õһ
+static const int kMaxLogDepth = 4;
+static __thread char t_logBuffers[kMaxLogDepth][kSmallBuffer];
+static __thread int t_logDepth = 0;
 
 //ȡ־Ψһʵ
-Logger& Logger::instance() 
+Logger& Logger::instance()
 {
 	static Logger logger;
 	return logger;
 }
 
-//־
-void Logger::setLogLevel(int level)
+void Logger::setOutput(OutputFunc out)
 {
-	logLevel_ = level;
+	g_output = std::move(out);
 }
 
-//д־	[Ϣ] time msg
-void Logger::log(std::string msg)
+void Logger::setFlush(FlushFunc flush)
+{
+	g_flush = std::move(flush);
+}
+
+int Logger::formatPrefix(int level, char* buf, int len)
 {
-	switch (logLevel_)
+	const char* levelName = "";
+	switch (level)
 	{
 		case INFO:
 		{
-			std::cout << " [INFO] ";
+			levelName = " [INFO] ";
 			break;
 		}
 		case ERROR:
 		{
-			std::cout << " [ERROR] ";
+			levelName = " [ERROR] ";
 			break;
 		}
 		case FATAL:
 		{
-			std::cout << " [FATAL] ";
+			levelName = " [FATAL] ";
 			break;
 		}
 		case DEBUG:
 		{
-			std::cout << " [DEBUG] ";
+			levelName = " [DEBUG] ";
 			break;
 		}
 		default:
 			break;
 	}
 
-	//ӡʱmsg
-	std::cout << Timestamp::now().toString()<<" : " << msg << std::endl;
+	char time[32];
+	Timestamp::now().formatTo(time, sizeof time);
+	int n = snprintf(buf, len, "%s%s : ", levelName, time);
+	return n < len ? n : len - 1;
+}
+
+void Logger::output(int level, const char* line, int len)
+{
+	g_output(line, len);
+	if (level == FATAL)
+	{
+		g_flush();
+	}
+}
+
+//д־	[Ϣ] time msg
+void Logger::log(int level, const char* msg)
+{
+	logf(level, "%s", msg);
+}
+
+//ջƴãһԽڵ߳flush
+void Logger::logf(int level, const char* fmt, ...)
+{
+	char line[1280];
+	int len = formatPrefix(level, line, sizeof line);
+
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(line + len, sizeof line - len, fmt, args);
+	va_end(args);
+	if (n < 0)
+	{
+		return;
+	}
+	len += n;
+	if (len > static_cast<int>(sizeof line) - 2)
+	{
+		len = static_cast<int>(sizeof line) - 2;
+	}
+	//msgԴеľͲ׷
+	if (line[len - 1] != '\n')
+	{
+		line[len++] = '\n';
+	}
+	output(level, line, len);
+}
+
+LogMessage::LogMessage(int level, const char* file, int line)
+	:level_(level),
+	file_(file),
+	line_(line),
+	stream_(t_logBuffers[t_logDepth < kMaxLogDepth ? t_logDepth : kMaxLogDepth - 1],
+		t_logDepth < kMaxLogDepth ? kSmallBuffer : 0)
+{
+	++t_logDepth;
+	char prefix[64];
+	int len = Logger::formatPrefix(level, prefix, sizeof prefix);
+	stream_.append(prefix, len);
+}
+
+LogMessage::~LogMessage()
+{
+	--t_logDepth;
+	if (stream_.length() == 0)
+	{
+		return;	//Ƕ̫
+	}
+
+	const char* base = strrchr(file_, '/');
+	stream_ << " - " << (base ? base + 1 : file_) << ':' << line_ << '\n';
+	Logger::output(level_, stream_.data(), stream_.length());
+	if (level_ == FATAL)
+	{
+		exit(-1);
+	}
 }
\ No newline at end of file
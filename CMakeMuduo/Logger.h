@@ -1,76 +1,123 @@
 #pragma once
 
 #include <string>
+#include <functional>
+#include <atomic>
+#include <stdlib.h>
 
 #include "noncopyable.h"
+#include "LogStream.h"
 
+//编译期的最低日志级别，低于它的日志语句会被编译器整个删掉
+//定义了MUDEBUG时默认保留DEBUG日志
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL 0
+#else
+#define MUDUO_MIN_LOG_LEVEL 1
+#endif
+#endif
+
+//所有日志宏都先检查级别，没有打开的级别不会执行格式化，参数也不会被求值
 //LOG_INFO("%s %d",arg1, arg2)
 #define LOG_INFO(logmsgFormat, ...) \
 	do \
 	{ \
-		Logger& logger = Logger::instance(); \
-		logger.setLogLevel(INFO); \
-		char buf[1024] = { 0 }; \
-		snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-		logger.log(buf); \
+		if (Logger::isEnabled(INFO)) \
+		{ \
+			Logger::instance().logf(INFO, logmsgFormat, ##__VA_ARGS__); \
+		} \
 	}while(0)
 
 #define LOG_ERROR(logmsgFormat, ...) \
 	do \
 	{ \
-		Logger& logger = Logger::instance(); \
-		logger.setLogLevel(ERROR); \
-		char buf[1024] = { 0 }; \
-		snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-		logger.log(buf); \
+		if (Logger::isEnabled(ERROR)) \
+		{ \
+			Logger::instance().logf(ERROR, logmsgFormat, ##__VA_ARGS__); \
+		} \
 	}while(0)
 
 #define LOG_FATAL(logmsgFormat, ...) \
 	do \
 	{ \
-		Logger& logger = Logger::instance(); \
-		logger.setLogLevel(FATAL); \
-		char buf[1024] = { 0 }; \
-		snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-		logger.log(buf); \
+		Logger::instance().logf(FATAL, logmsgFormat, ##__VA_ARGS__); \
 		exit(-1); \
 	}while(0)
 
-
-#ifdef MUDEBUG
 #define LOG_DEBUG(logmsgFormat, ...) \
 	do \
 	{ \
-		Logger& logger = Logger::instance(); \
-		logger.setLogLevel(DEBUG); \
-		char buf[1024] = { 0 }; \
-		snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-		logger.log(buf); \
+		if (Logger::isEnabled(DEBUG)) \
+		{ \
+			Logger::instance().logf(DEBUG, logmsgFormat, ##__VA_ARGS__); \
+		} \
 	}while(0)
-#else
-	#define LOG_DEBUG(logmsgFormat, ...) 
-#endif
 
-//定义日志的级别 INFO  ERROR  FATAL	 DEBUG
+//流式日志 LOG_STREAM(INFO) << "fd=" << fd << " bytes=" << n;
+//格式化到线程局部的定长缓冲区中，不分配堆内存，类型由编译器检查
+#define LOG_STREAM(level) \
+	if (!Logger::isEnabled(level)) {} \
+	else LogMessage(level, __FILE__, __LINE__).stream()
+
+//定义日志的级别 DEBUG  INFO  ERROR  FATAL 级别越高数值越大
 enum LogLevel
 {
+	DEBUG,	//调试信息
 	INFO,	//普通信息
 	ERROR,	//错误信息
 	FATAL,	//core信息
-	DEBUG,	//调试信息
 };
 
 //输出一个日志类
 class Logger:noncopyable
 {
 public:
+	//日志的输出位置，默认输出到stdout，可以换成AsyncLogging::append
+	using OutputFunc = std::function<void(const char* msg, int len)>;
+	using FlushFunc = std::function<void()>;
+
 	//获取日志唯一的实例对象
 	static Logger& instance();
-	//设置日志级别
-	void setLogLevel(int level);
-	//写日志
-	void log(std::string msg);
+	//写日志 级别作为参数传入，多个线程同时写日志不会互相影响
+	void log(int level, const char* msg);
+	void logf(int level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+	//设置运行时的日志级别，低于该级别的日志不输出
+	static void setLogLevel(int level) { s_logLevel_.store(level, std::memory_order_relaxed); }
+	static int logLevel() { return s_logLevel_.load(std::memory_order_relaxed); }
+
+	//前半部分是编译期常量，被关闭的日志只剩一次读取和一个分支
+	static bool isEnabled(int level)
+	{
+		return level >= MUDUO_MIN_LOG_LEVEL && level >= logLevel();
+	}
+
+	static void setOutput(OutputFunc out);
+	//LOG_FATAL在exit之前调用，默认fflush(stdout)，使用AsyncLogging时设置为AsyncLogging::stop
+	static void setFlush(FlushFunc flush);
+
+	//把" [INFO] time : "格式的前缀写入buf，返回长度
+	static int formatPrefix(int level, char* buf, int len);
+	//输出一行完整的日志，FATAL级别会同时flush
+	static void output(int level, const char* line, int len);
 private:
-	int logLevel_;
 	Logger(){}
+
+	static std::atomic<int> s_logLevel_;
+};
+
+//LOG_STREAM使用的临时对象，析构时把整行日志交给输出函数
+class LogMessage :noncopyable
+{
+public:
+	LogMessage(int level, const char* file, int line);
+	~LogMessage();
+
+	LogStream& stream() { return stream_; }
+private:
+	int level_;
+	const char* file_;
+	int line_;
+	LogStream stream_;
 };
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "LoopMetrics.h"
+#include "EventLoop.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+static void resetCounter(std::atomic<int64_t>* counter)
+{
+	counter->store(0, std::memory_order_relaxed);
+}
+
+static int bucketOf(int64_t value)
+{
+	if (value <= 0)
+	{
+		return 0;
+	}
+	int bucket = 64 - __builtin_clzll(static_cast<uint64_t>(value));
+	return bucket < LoopMetrics::kBuckets ? bucket : LoopMetrics::kBuckets - 1;
+}
+
+void LoopMetrics::Histogram::merge(const Histogram& other)
+{
+	for (int i = 0; i < kBuckets; i++)
+	{
+		buckets[i] += other.buckets[i];
+	}
+	count += other.count;
+	sum += other.sum;
+	if (other.max > max)
+	{
+		max = other.max;
+	}
+}
+
+int64_t LoopMetrics::Histogram::percentile(double q) const
+{
+	if (count <= 0)
+	{
+		return 0;
+	}
+	int64_t target = static_cast<int64_t>(q * count);
+	if (target >= count)
+	{
+		target = count - 1;
+	}
+	int64_t seen = 0;
+	for (int i = 0; i < kBuckets; i++)
+	{
+		seen += buckets[i];
+		if (seen > target)
+		{
+			int64_t upper = upperBound(i);
+			return upper < max ? upper : max;
+		}
+	}
+	return max;
+}
+
+int64_t LoopMetrics::Histogram::upperBound(int bucket)
+{
+	if (bucket <= 0)
+	{
+		return 0;
+	}
+	if (bucket >= kBuckets - 1)
+	{
+		return INT64_MAX;
+	}
+	return (static_cast<int64_t>(1) << bucket) - 1;
+}
+
+void LoopMetrics::Snapshot::merge(const Snapshot& other)
+{
+	iterations += other.iterations;
+	events += other.events;
+	functors += other.functors;
+	busyMicroSeconds += other.busyMicroSeconds;
+	bytesIn += other.bytesIn;
+	bytesOut += other.bytesOut;
+	connections += other.connections;
+	iterationMicros.merge(other.iterationMicros);
+	eventsPerPoll.merge(other.eventsPerPoll);
+	functorsPerRound.merge(other.functorsPerRound);
+}
+
+LoopMetrics::LoopMetrics()
+{
+	//std::atomic的默认构造不初始化
+	Counter* counters[] = { &iterations_, &events_, &functors_, &busyMicroSeconds_, &bytesIn_, &bytesOut_ };
+	for (Counter* counter : counters)
+	{
+		resetCounter(counter);
+	}
+	HistogramCounter* histograms[] = { &iterationMicros_, &eventsPerPoll_, &functorsPerRound_ };
+	for (HistogramCounter* histogram : histograms)
+	{
+		for (int i = 0; i < kBuckets; i++)
+		{
+			resetCounter(&histogram->buckets[i]);
+		}
+		resetCounter(&histogram->count);
+		resetCounter(&histogram->sum);
+		resetCounter(&histogram->max);
+	}
+}
+
+void LoopMetrics::record(HistogramCounter* histogram, int64_t value)
+{
+	add(&histogram->buckets[bucketOf(value)], 1);
+	add(&histogram->count, 1);
+	add(&histogram->sum, value);
+	if (value > histogram->max.load(std::memory_order_relaxed))
+	{
+		histogram->max.store(value, std::memory_order_relaxed);
+	}
+}
+
+void LoopMetrics::read(const HistogramCounter& histogram, Histogram* out)
+{
+	for (int i = 0; i < kBuckets; i++)
+	{
+		out->buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+	}
+	out->count = histogram.count.load(std::memory_order_relaxed);
+	out->sum = histogram.sum.load(std::memory_order_relaxed);
+	out->max = histogram.max.load(std::memory_order_relaxed);
+}
+
+void LoopMetrics::recordIteration(int64_t busyMicros, size_t events, size_t functors)
+{
+	if (busyMicros < 0)
+	{
+		busyMicros = 0;
+	}
+	add(&iterations_, 1);
+	add(&events_, static_cast<int64_t>(events));
+	add(&functors_, static_cast<int64_t>(functors));
+	add(&busyMicroSeconds_, busyMicros);
+	record(&iterationMicros_, busyMicros);
+	record(&eventsPerPoll_, static_cast<int64_t>(events));
+	record(&functorsPerRound_, static_cast<int64_t>(functors));
+}
+
+void LoopMetrics::snapshot(Snapshot* snap) const
+{
+	snap->iterations = iterations_.load(std::memory_order_relaxed);
+	snap->events = events_.load(std::memory_order_relaxed);
+	snap->functors = functors_.load(std::memory_order_relaxed);
+	snap->busyMicroSeconds = busyMicroSeconds_.load(std::memory_order_relaxed);
+	snap->bytesIn = bytesIn_.load(std::memory_order_relaxed);
+	snap->bytesOut = bytesOut_.load(std::memory_order_relaxed);
+	snap->connections = 0;
+	read(iterationMicros_, &snap->iterationMicros);
+	read(eventsPerPoll_, &snap->eventsPerPoll);
+	read(functorsPerRound_, &snap->functorsPerRound);
+}
+
+LoopMetrics::Snapshot LoopMetrics::collect(const std::vector<EventLoop*>& loops, std::vector<Snapshot>* perLoop)
+{
+	Snapshot total;
+	::memset(&total, 0, sizeof total);
+	if (perLoop != nullptr)
+	{
+		perLoop->resize(loops.size());
+	}
+	for (size_t i = 0; i < loops.size(); i++)
+	{
+		Snapshot snap;
+		loops[i]->metrics().snapshot(&snap);
+		snap.connections = loops[i]->numConnections();
+		total.merge(snap);
+		if (perLoop != nullptr)
+		{
+			(*perLoop)[i] = snap;
+		}
+	}
+	return total;
+}
+
+static void appendf(std::string* out, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void appendf(std::string* out, const char* fmt, ...)
+{
+	char buf[256];
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf, sizeof buf, fmt, args);
+	va_end(args);
+	if (n > 0)
+	{
+		out->append(buf, static_cast<size_t>(n) < sizeof buf ? n : sizeof buf - 1);
+	}
+}
+
+//同一个指标的所有loop放在一起，前面是一行TYPE
+static void appendScalar(std::string* out, const std::string& prefix, const char* name, const char* type,
+	const std::vector<LoopMetrics::Snapshot>& perLoop, int64_t LoopMetrics::Snapshot::* field)
+{
+	appendf(out, "# TYPE %s_%s %s\n", prefix.c_str(), name, type);
+	for (size_t i = 0; i < perLoop.size(); i++)
+	{
+		appendf(out, "%s_%s{loop=\"%zu\"} %lld\n", prefix.c_str(), name, i,
+			static_cast<long long>(perLoop[i].*field));
+	}
+}
+
+static void appendHistogram(std::string* out, const std::string& prefix, const char* name,
+	const std::vector<LoopMetrics::Snapshot>& perLoop, LoopMetrics::Histogram LoopMetrics::Snapshot::* field)
+{
+	appendf(out, "# TYPE %s_%s histogram\n", prefix.c_str(), name);
+	for (size_t i = 0; i < perLoop.size(); i++)
+	{
+		const LoopMetrics::Histogram& h = perLoop[i].*field;
+		//Prometheus的桶是累计的
+		int64_t cumulative = 0;
+		for (int b = 0; b < LoopMetrics::kBuckets - 1; b++)
+		{
+			cumulative += h.buckets[b];
+			appendf(out, "%s_%s_bucket{loop=\"%zu\",le=\"%lld\"} %lld\n", prefix.c_str(), name, i,
+				static_cast<long long>(LoopMetrics::Histogram::upperBound(b)), static_cast<long long>(cumulative));
+		}
+		appendf(out, "%s_%s_bucket{loop=\"%zu\",le=\"+Inf\"} %lld\n", prefix.c_str(), name, i,
+			static_cast<long long>(h.count));
+		appendf(out, "%s_%s_sum{loop=\"%zu\"} %lld\n", prefix.c_str(), name, i, static_cast<long long>(h.sum));
+		appendf(out, "%s_%s_count{loop=\"%zu\"} %lld\n", prefix.c_str(), name, i, static_cast<long long>(h.count));
+	}
+}
+
+std::string LoopMetrics::toPrometheus(const std::vector<Snapshot>& perLoop, const std::string& prefix)
+{
+	std::string out;
+	appendScalar(&out, prefix, "iterations_total", "counter", perLoop, &Snapshot::iterations);
+	appendScalar(&out, prefix, "events_total", "counter", perLoop, &Snapshot::events);
+	appendScalar(&out, prefix, "functors_total", "counter", perLoop, &Snapshot::functors);
+	appendScalar(&out, prefix, "busy_microseconds_total", "counter", perLoop, &Snapshot::busyMicroSeconds);
+	appendScalar(&out, prefix, "bytes_in_total", "counter", perLoop, &Snapshot::bytesIn);
+	appendScalar(&out, prefix, "bytes_out_total", "counter", perLoop, &Snapshot::bytesOut);
+	appendScalar(&out, prefix, "connections", "gauge", perLoop, &Snapshot::connections);
+	appendHistogram(&out, prefix, "iteration_microseconds", perLoop, &Snapshot::iterationMicros);
+	appendHistogram(&out, prefix, "events_per_poll", perLoop, &Snapshot::eventsPerPoll);
+	appendHistogram(&out, prefix, "functors_per_round", perLoop, &Snapshot::functorsPerRound);
+	return out;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class EventLoop;
+
+//每个EventLoop的运行统计，EventLoop持有一个
+//只有loop线程写，写是relaxed的load加store，没有带lock前缀的指令，开销和普通变量一样
+//其他线程随时可以读，各项之间不保证是同一时刻的值，用于监控足够了
+class LoopMetrics :noncopyable
+{
+public:
+	//对数分桶 桶0统计0，桶i统计[2^(i-1), 2^i)，最后一个桶统计所有更大的值
+	static const int kBuckets = 32;
+
+	//直方图的快照 POD，可以直接放进共享内存
+	struct Histogram
+	{
+		int64_t buckets[kBuckets];
+		int64_t count;
+		int64_t sum;
+		int64_t max;
+
+		void merge(const Histogram& other);
+		double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0; }
+		//q在0到1之间，返回所在桶的上界，不超过max
+		int64_t percentile(double q) const;
+		//桶的上界(包含)，最后一个桶返回INT64_MAX
+		static int64_t upperBound(int bucket);
+	};
+
+	//一个或者多个loop的统计快照 POD
+	struct Snapshot
+	{
+		int64_t iterations;			//loop循环的轮数
+		int64_t events;				//poll返回的channel总数
+		int64_t functors;			//执行的pendingFunctors总数
+		int64_t busyMicroSeconds;	//从poll返回到执行完回调累计的时间
+		int64_t bytesIn;			//TcpConnection读到的字节数
+		int64_t bytesOut;			//TcpConnection写出的字节数
+		int64_t connections;		//当前的TcpConnection个数
+		Histogram iterationMicros;	//每轮从poll返回到执行完回调的耗时，单位微秒
+		Histogram eventsPerPoll;	//每次poll返回的channel个数
+		Histogram functorsPerRound;	//每轮执行的pendingFunctors个数，也就是开始执行时队列的深度
+
+		void merge(const Snapshot& other);
+	};
+
+	LoopMetrics();
+
+	//下面三个只能在loop线程中调用
+	void recordIteration(int64_t busyMicros, size_t events, size_t functors);
+	void addBytesIn(size_t n) { add(&bytesIn_, static_cast<int64_t>(n)); }
+	void addBytesOut(size_t n) { add(&bytesOut_, static_cast<int64_t>(n)); }
+
+	//下面的可以在任意线程调用
+	int64_t busyMicroSeconds() const { return busyMicroSeconds_.load(std::memory_order_relaxed); }
+	//connections不在LoopMetrics中，由调用者填写，这里置0
+	void snapshot(Snapshot* snap) const;
+
+	//依次读取loops的统计，perLoop不为空时保存每个loop各自的快照，返回所有loop的合计
+	//一般传入EventLoopThreadPool::getAllLoops()
+	static Snapshot collect(const std::vector<EventLoop*>& loops, std::vector<Snapshot>* perLoop = nullptr);
+
+	//Prometheus的文本格式，每个loop一组，用loop="i"标签区分
+	static std::string toPrometheus(const std::vector<Snapshot>& perLoop, const std::string& prefix = "muduo_loop");
+
+private:
+	using Counter = std::atomic<int64_t>;
+
+	struct HistogramCounter
+	{
+		Counter buckets[kBuckets];
+		Counter count;
+		Counter sum;
+		Counter max;
+	};
+
+	//只有一个写者，不需要原子的加法
+	static void add(Counter* counter, int64_t delta)
+	{
+		counter->store(counter->load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+	static void record(HistogramCounter* histogram, int64_t value);
+	static void read(const HistogramCounter& histogram, Histogram* out);
+
+	Counter iterations_;
+	Counter events_;
+	Counter functors_;
+	Counter busyMicroSeconds_;
+	Counter bytesIn_;
+	Counter bytesOut_;
+	HistogramCounter iterationMicros_;
+	HistogramCounter eventsPerPoll_;
+	HistogramCounter functorsPerRound_;
+};
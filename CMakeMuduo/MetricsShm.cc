@@ -0,0 +1,157 @@
+#include "MetricsShm.h"
+#include "Logger.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//读者看到奇数的sequence或者前后两次不一样就重试，重试这么多次还不成功就放弃
+static const int kMaxReadRetries = 1000;
+
+//Snapshot数组紧跟在Region后面
+struct MetricsShm::Region
+{
+	std::atomic<uint64_t> sequence;	//奇数表示正在写
+	Header header;
+};
+
+static LoopMetrics::Snapshot* snapshotsOf(void* region)
+{
+	return reinterpret_cast<LoopMetrics::Snapshot*>(static_cast<char*>(region) + sizeof(MetricsShm::Header) + sizeof(uint64_t));
+}
+
+size_t MetricsShm::regionSize(int maxLoops)
+{
+	return sizeof(Region) + sizeof(LoopMetrics::Snapshot) * maxLoops;
+}
+
+MetricsShm::MetricsShm(const std::string& name, int maxLoops)
+	:name_(name), maxLoops_(maxLoops > 0 ? maxLoops : 1), region_(nullptr)
+{
+	static_assert(sizeof(Region) == sizeof(Header) + sizeof(uint64_t), "unexpected padding in MetricsShm::Region");
+
+	int fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		LOG_ERROR("MetricsShm::MetricsShm shm_open %s error:%d\n", name_.c_str(), errno);
+		return;
+	}
+	size_t size = regionSize(maxLoops_);
+	if (::ftruncate(fd, static_cast<off_t>(size)) < 0)
+	{
+		LOG_ERROR("MetricsShm::MetricsShm ftruncate %s error:%d\n", name_.c_str(), errno);
+		::close(fd);
+		return;
+	}
+	void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED)
+	{
+		LOG_ERROR("MetricsShm::MetricsShm mmap %s error:%d\n", name_.c_str(), errno);
+		return;
+	}
+
+	::memset(addr, 0, size);
+	region_ = static_cast<Region*>(addr);
+	region_->sequence.store(0, std::memory_order_relaxed);
+	region_->header.magic = kMagic;
+	region_->header.version = kVersion;
+	region_->header.pid = static_cast<int32_t>(::getpid());
+	region_->header.maxLoops = maxLoops_;
+	region_->header.snapshotSize = static_cast<int32_t>(sizeof(LoopMetrics::Snapshot));
+	region_->header.numLoops = 0;
+	region_->header.publishMicros = 0;
+}
+
+MetricsShm::~MetricsShm()
+{
+	if (region_ != nullptr)
+	{
+		::munmap(region_, regionSize(maxLoops_));
+		::shm_unlink(name_.c_str());
+	}
+}
+
+void MetricsShm::publish(const std::vector<EventLoop*>& loops)
+{
+	std::vector<LoopMetrics::Snapshot> perLoop;
+	LoopMetrics::collect(loops, &perLoop);
+	publish(perLoop);
+}
+
+void MetricsShm::publish(const std::vector<LoopMetrics::Snapshot>& perLoop)
+{
+	if (region_ == nullptr)
+	{
+		return;
+	}
+	int numLoops = static_cast<int>(perLoop.size()) < maxLoops_ ? static_cast<int>(perLoop.size()) : maxLoops_;
+
+	uint64_t sequence = region_->sequence.load(std::memory_order_relaxed);
+	region_->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	region_->header.numLoops = numLoops;
+	region_->header.publishMicros = Timestamp::now().microSecondsSinceEpoch();
+	if (numLoops > 0)
+	{
+		::memcpy(snapshotsOf(region_), perLoop.data(), sizeof(LoopMetrics::Snapshot) * numLoops);
+	}
+
+	region_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool MetricsShm::read(const std::string& name, Header* header, std::vector<LoopMetrics::Snapshot>* perLoop)
+{
+	int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (::fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Region))
+	{
+		::close(fd);
+		return false;
+	}
+	size_t size = static_cast<size_t>(st.st_size);
+	void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (addr == MAP_FAILED)
+	{
+		return false;
+	}
+
+	const Region* region = static_cast<const Region*>(addr);
+	bool ok = false;
+	for (int retry = 0; retry < kMaxReadRetries && !ok; retry++)
+	{
+		uint64_t before = region->sequence.load(std::memory_order_acquire);
+		if (before & 1)
+		{
+			continue;
+		}
+		*header = region->header;
+		if (header->magic != kMagic || header->version != kVersion
+			|| header->snapshotSize != static_cast<int32_t>(sizeof(LoopMetrics::Snapshot))
+			|| header->numLoops < 0 || header->numLoops > header->maxLoops || size < regionSize(header->maxLoops))
+		{
+			break;
+		}
+		perLoop->resize(header->numLoops);
+		if (header->numLoops > 0)
+		{
+			::memcpy(perLoop->data(), snapshotsOf(addr), sizeof(LoopMetrics::Snapshot) * header->numLoops);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		ok = region->sequence.load(std::memory_order_relaxed) == before;
+	}
+	::munmap(addr, size);
+	return ok;
+}
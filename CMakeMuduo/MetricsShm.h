@@ -0,0 +1,56 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "LoopMetrics.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class EventLoop;
+
+//把各个loop的统计发布到POSIX共享内存(/dev/shm)，外部工具只读映射，不需要和进程通信
+//布局是一个Header加上maxLoops个LoopMetrics::Snapshot，写的时候用seqlock，读者重试直到读到完整的一次发布
+//一般在baseloop上用runEvery定时publish(threadPool()->getAllLoops())
+class MetricsShm :noncopyable
+{
+public:
+	static const uint32_t kMagic = 0x4d4d4554;	//"MMET"
+	static const uint32_t kVersion = 1;
+
+	//共享内存开头的描述信息，读者据此检查布局是否一致
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		int32_t pid;
+		int32_t maxLoops;
+		int32_t snapshotSize;	//sizeof(LoopMetrics::Snapshot)
+		int32_t numLoops;		//最近一次发布的loop个数
+		int64_t publishMicros;	//最近一次发布的时间 Timestamp::now
+	};
+
+	//name是shm_open的名字，以'/'开头，例如"/mymuduo-8000"，已经存在时覆盖
+	explicit MetricsShm(const std::string& name, int maxLoops = 64);
+	//删除共享内存
+	~MetricsShm();
+
+	bool valid() const { return region_ != nullptr; }
+	const std::string& name() const { return name_; }
+
+	//同一时刻只能有一个线程发布，超过maxLoops的loop不发布
+	void publish(const std::vector<EventLoop*>& loops);
+	void publish(const std::vector<LoopMetrics::Snapshot>& perLoop);
+
+	//给外部工具用 打开name读取一次，布局不一致或者不存在时返回false
+	static bool read(const std::string& name, Header* header, std::vector<LoopMetrics::Snapshot>* perLoop);
+
+private:
+	struct Region;
+
+	static size_t regionSize(int maxLoops);
+
+	const std::string name_;
+	const int maxLoops_;
+	Region* region_;
+};
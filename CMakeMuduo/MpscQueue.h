@@ -0,0 +1,71 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <utility>
+
+//无锁的多生产者单消费者队列 (Dmitry Vyukov的非侵入式MPSC队列)
+//push可以在任意线程调用，只需要一次原子exchange；pop只能在一个线程中调用
+//队列中始终有一个哑节点，tail_指向它，真正的数据从tail_->next开始
+//push在exchange和链接next之间被打断时，pop会暂时看不到这个以及之后的元素，
+//调用者需要保证push完成后还会再pop一次(EventLoop用wakeupPending_保证)
+template<typename T>
+class MpscQueue :noncopyable
+{
+public:
+	MpscQueue()
+		:head_(new Node),
+		tail_(head_.load(std::memory_order_relaxed))
+	{}
+
+	~MpscQueue()
+	{
+		T value;
+		while (pop(&value))
+		{
+		}
+		delete tail_;
+	}
+
+	void push(T value)
+	{
+		Node* node = new Node(std::move(value));
+		Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	//只能在消费者线程中调用，队列为空时返回false
+	bool pop(T* value)
+	{
+		Node* tail = tail_;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr)
+		{
+			return false;
+		}
+		*value = std::move(next->value);
+		tail_ = next;	//next成为新的哑节点
+		delete tail;
+		return true;
+	}
+
+	//只能在消费者线程中调用，结果只是一个近似值
+	bool empty() const
+	{
+		return tail_->next.load(std::memory_order_acquire) == nullptr;
+	}
+private:
+	struct Node
+	{
+		Node() :next(nullptr) {}
+		explicit Node(T&& v) :next(nullptr), value(std::move(v)) {}
+
+		std::atomic<Node*> next;
+		T value;
+	};
+
+	std::atomic<Node*> head_;	//生产者push的位置
+	char pad_[64 - sizeof(std::atomic<Node*>)];	//head_和tail_放在不同的缓存行，生产者和消费者互不干扰
+	Node* tail_;	//消费者pop的位置
+};
@@ -0,0 +1,237 @@
+#include "OutputQueue.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+
+//sendfile单次最多发送0x7ffff000字节
+static const size_t kMaxSendfileChunk = 0x7ffff000;
+static const int kMaxIovecs = IOV_MAX;
+
+OutputQueue::OutputQueue()
+	:bytes_(0),
+	fileBytes_(0)
+{}
+
+OutputQueue::~OutputQueue()
+{}
+
+void OutputQueue::append(const char* data, size_t len)
+{
+	if (len == 0)
+	{
+		return;
+	}
+	if (segments_.empty() || segments_.back().type != Segment::kBuffer)
+	{
+		Segment seg;
+		seg.type = Segment::kBuffer;
+		if (spare_)
+		{
+			seg.buffer = std::move(spare_);
+		}
+		else
+		{
+			seg.buffer.reset(new Buffer);
+		}
+		segments_.push_back(std::move(seg));
+	}
+	segments_.back().buffer->append(data, len);
+	bytes_ += len;
+}
+
+void OutputQueue::append(const SharedString& str, size_t offset, size_t len)
+{
+	if (len == 0)
+	{
+		return;
+	}
+	Segment seg;
+	seg.type = Segment::kSlice;
+	seg.str = str;
+	seg.data = str->data() + offset;
+	seg.len = len;
+	segments_.push_back(std::move(seg));
+	bytes_ += len;
+}
+
+void OutputQueue::append(Buffer* buf)
+{
+	size_t len = buf->readableBytes();
+	if (len == 0)
+	{
+		return;
+	}
+	Segment seg;
+	seg.type = Segment::kBuffer;
+	if (spare_)
+	{
+		seg.buffer = std::move(spare_);
+	}
+	else
+	{
+		seg.buffer.reset(new Buffer(0));
+	}
+	seg.buffer->swap(*buf);
+	segments_.push_back(std::move(seg));
+	bytes_ += len;
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t length)
+{
+	if (length == 0)
+	{
+		return;
+	}
+	Segment seg;
+	seg.type = Segment::kFile;
+	seg.fd = fd;
+	seg.offset = offset;
+	seg.len = length;
+	segments_.push_back(std::move(seg));
+	bytes_ += length;
+	fileBytes_ += length;
+}
+
+ssize_t OutputQueue::writeTo(int fd, int* savedErrno, size_t maxBytes)
+{
+	ssize_t total = 0;
+	bool blocked = false;
+	while (!segments_.empty() && !blocked && static_cast<size_t>(total) < maxBytes)
+	{
+		ssize_t n = segments_.front().type == Segment::kFile
+			? writeFile(fd, savedErrno, &blocked)
+			: writeMemory(fd, savedErrno, &blocked);
+		if (n < 0)
+		{
+			return -1;
+		}
+		total += n;
+	}
+	return total;
+}
+
+ssize_t OutputQueue::writeMemory(int fd, int* savedErrno, bool* blocked)
+{
+	struct iovec vec[kMaxIovecs];
+	int iovcnt = 0;
+	size_t expected = 0;
+	for (auto it = segments_.begin(); it != segments_.end() && iovcnt < kMaxIovecs; ++it)
+	{
+		if (it->type == Segment::kFile)
+		{
+			break;
+		}
+		if (it->type == Segment::kBuffer)
+		{
+			vec[iovcnt].iov_base = const_cast<char*>(it->buffer->peek());
+			vec[iovcnt].iov_len = it->buffer->readableBytes();
+		}
+		else
+		{
+			vec[iovcnt].iov_base = const_cast<char*>(it->data);
+			vec[iovcnt].iov_len = it->len;
+		}
+		expected += vec[iovcnt].iov_len;
+		iovcnt++;
+	}
+
+	ssize_t n = ::writev(fd, vec, iovcnt);
+	if (n < 0)
+	{
+		if (errno == EWOULDBLOCK || errno == EINTR)
+		{
+			*blocked = true;
+			return 0;
+		}
+		*savedErrno = errno;
+		return -1;
+	}
+	consume(n);
+	if (static_cast<size_t>(n) < expected)
+	{
+		*blocked = true;	//内核发送缓冲区满了
+	}
+	return n;
+}
+
+ssize_t OutputQueue::writeFile(int fd, int* savedErrno, bool* blocked)
+{
+	Segment& seg = segments_.front();
+	size_t chunk = seg.len < kMaxSendfileChunk ? seg.len : kMaxSendfileChunk;
+	ssize_t n = ::sendfile(fd, seg.fd, &seg.offset, chunk);
+	if (n > 0)
+	{
+		seg.len -= n;
+		bytes_ -= n;
+		fileBytes_ -= n;
+		if (seg.len == 0)
+		{
+			popFront();
+		}
+		else if (static_cast<size_t>(n) < chunk)
+		{
+			*blocked = true;
+		}
+		return n;
+	}
+	else if (n == 0)
+	{
+		//文件比length短，剩下的部分无法发送，跳过会让之后的数据错位，当作写错误关闭连接
+		LOG_ERROR("OutputQueue::writeFile fd=%d reached EOF with %zu bytes unsent\n", seg.fd, seg.len);
+		*savedErrno = ENODATA;
+		return -1;
+	}
+
+	if (errno == EWOULDBLOCK || errno == EINTR)
+	{
+		*blocked = true;
+		return 0;
+	}
+	*savedErrno = errno;
+	return -1;
+}
+
+void OutputQueue::consume(size_t n)
+{
+	bytes_ -= n;
+	while (n > 0)
+	{
+		Segment& seg = segments_.front();
+		if (seg.type == Segment::kBuffer)
+		{
+			size_t readable = seg.buffer->readableBytes();
+			if (n < readable)
+			{
+				seg.buffer->retrieve(n);
+				return;
+			}
+			n -= readable;
+		}
+		else
+		{
+			if (n < seg.len)
+			{
+				seg.data += n;
+				seg.len -= n;
+				return;
+			}
+			n -= seg.len;
+		}
+		popFront();
+	}
+}
+
+void OutputQueue::popFront()
+{
+	Segment& seg = segments_.front();
+	if (seg.type == Segment::kBuffer && !spare_)
+	{
+		//存储空间在retrieveAll时已经还给内存池，这里只留下Buffer对象
+		seg.buffer->retrieveAll();
+		spare_ = std::move(seg.buffer);
+	}
+	segments_.pop_front();
+}
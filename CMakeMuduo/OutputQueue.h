@@ -0,0 +1,69 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Buffer.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+//TcpConnection的发送队列 由多个分段组成，按加入的顺序发送
+//	kBuffer 自己持有的Buffer，零散的小数据拷贝进队尾的Buffer里合并
+//	kSlice  引用计数的只读字符串，不拷贝数据
+//	kFile   文件区间，用sendfile发送
+//连续的内存分段用一次writev发送，最多IOV_MAX个，调用者交过来的数据不需要先拼成一块连续内存
+class OutputQueue :noncopyable
+{
+public:
+	using SharedString = std::shared_ptr<const std::string>;
+
+	OutputQueue();
+	~OutputQueue();
+
+	//拷贝data到队尾的Buffer中
+	void append(const char* data, size_t len);
+	//引用str中[offset, offset+len)的数据，不拷贝
+	void append(const SharedString& str, size_t offset, size_t len);
+	//交换buf的内容到队列中，buf变为空
+	void append(Buffer* buf);
+	//文件fd中[offset, offset+length)的内容，fd由调用者保证发送完之前一直有效
+	void appendFile(int fd, off_t offset, size_t length);
+
+	//待发送的总字节数
+	size_t bytes() const { return bytes_; }
+	//待发送的内存中的字节数，不包括文件区间
+	size_t memoryBytes() const { return bytes_ - fileBytes_; }
+	bool empty() const { return segments_.empty(); }
+
+	//尽可能多的写入fd，直到全部发送完、内核缓冲区满或者发送了至少maxBytes字节
+	//返回本次发送的字节数，出错返回-1并设置savedErrno
+	ssize_t writeTo(int fd, int* savedErrno, size_t maxBytes = SIZE_MAX);
+private:
+	struct Segment
+	{
+		enum Type { kBuffer, kSlice, kFile };
+
+		Type type;
+		std::unique_ptr<Buffer> buffer;	//kBuffer
+		SharedString str;				//kSlice 持有数据的引用计数
+		const char* data;				//kSlice 下一个要发送的位置
+		int fd;							//kFile
+		off_t offset;					//kFile 下一个要发送的位置
+		size_t len;						//kSlice kFile 剩余的字节数
+	};
+
+	//writev连续的内存分段
+	ssize_t writeMemory(int fd, int* savedErrno, bool* blocked);
+	//sendfile队头的文件分段
+	ssize_t writeFile(int fd, int* savedErrno, bool* blocked);
+	//已经发送了n字节，移除或者推进队头的分段
+	void consume(size_t n);
+	void popFront();
+
+	std::list<Segment> segments_;	//空的list不分配内存，空闲连接不占用额外空间
+	size_t bytes_;
+	size_t fileBytes_;				//bytes_中kFile分段的部分
+	std::unique_ptr<Buffer> spare_;	//发送完的Buffer对象留一个下次复用
+};
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "PollPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+#include <errno.h>
+#include <algorithm>
+
+PollPoller::PollPoller(EventLoop* loop)
+	:Poller(loop)
+{}
+
+PollPoller::~PollPoller()
+{}
+
+Timestamp PollPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+	//边沿触发的channel打开关闭写事件时不会调用update，这里重新取一次
+	for (struct pollfd& pfd : pollfds_)
+	{
+		if (pfd.fd >= 0)
+		{
+			pfd.events = static_cast<short>(channels_[pfd.fd]->events());
+		}
+	}
+
+	int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
+	int saveErrno = errno;
+	Timestamp now(Timestamp::now());
+	if (numEvents > 0)
+	{
+		LOG_DEBUG("%d events happened\n", numEvents);
+		fillActiveChannels(numEvents, activeChannels);
+	}
+	else if (numEvents < 0 && saveErrno != EINTR)
+	{
+		errno = saveErrno;
+		LOG_ERROR("PollPoller::poll() err!\n");
+	}
+	return now;
+}
+
+void PollPoller::fillActiveChannels(int numEvents, ChannelList* activeChannels) const
+{
+	for (auto it = pollfds_.begin(); it != pollfds_.end() && numEvents > 0; ++it)
+	{
+		if (it->revents > 0)
+		{
+			--numEvents;
+			Channel* channel = channels_.find(it->fd)->second;
+			channel->set_revents(it->revents);
+			activeChannels->push_back(channel);
+		}
+	}
+}
+
+void PollPoller::updateChannel(Channel* channel)
+{
+	LOG_DEBUG("func=%s => fd=%d events=%d\n", __FUNCTION__, channel->fd(), channel->events());
+	if (channel->index() < 0)
+	{
+		//新的channel，加到pollfds_的末尾
+		struct pollfd pfd;
+		pfd.fd = channel->fd();
+		pfd.events = static_cast<short>(channel->events());
+		pfd.revents = 0;
+		pollfds_.push_back(pfd);
+		channel->set_index(static_cast<int>(pollfds_.size()) - 1);
+		channels_[pfd.fd] = channel;
+	}
+	else
+	{
+		struct pollfd& pfd = pollfds_[channel->index()];
+		pfd.fd = channel->fd();
+		pfd.events = static_cast<short>(channel->events());
+		pfd.revents = 0;
+		if (channel->isNoneEvent())
+		{
+			//不关注任何事件时fd取负数，poll会忽略，channel的位置保留
+			pfd.fd = -channel->fd() - 1;
+		}
+	}
+}
+
+void PollPoller::removeChannel(Channel* channel)
+{
+	LOG_DEBUG("func=%s => fd=%d\n", __FUNCTION__, channel->fd());
+	int idx = channel->index();
+	channels_.erase(channel->fd());
+	//和最后一个交换之后删除，O(1)
+	if (static_cast<size_t>(idx) != pollfds_.size() - 1)
+	{
+		int lastFd = pollfds_.back().fd;
+		std::iter_swap(pollfds_.begin() + idx, pollfds_.end() - 1);
+		if (lastFd < 0)
+		{
+			lastFd = -lastFd - 1;
+		}
+		channels_[lastFd]->set_index(idx);
+	}
+	pollfds_.pop_back();
+	channel->set_index(-1);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <poll.h>
+
+class Channel;
+
+//poll的使用 每次poll前按照Channel当前的events_刷新pollfd，不支持边沿触发
+//边沿触发的channel在这里按水平触发处理，回调一直读写到EAGAIN同样是正确的
+class PollPoller :public Poller
+{
+public:
+	PollPoller(EventLoop* loop);
+	~PollPoller() override;
+
+	Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+	void updateChannel(Channel* channel) override;
+	void removeChannel(Channel* channel) override;
+private:
+	void fillActiveChannels(int numEvents, ChannelList* activeChannels) const;
+
+	using PollFdList = std::vector<struct pollfd>;
+	PollFdList pollfds_;	//Channel的index_是在pollfds_中的下标
+};
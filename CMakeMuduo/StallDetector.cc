@@ -0,0 +1,236 @@
+#include "StallDetector.h"
+#include "Logger.h"
+#include "Channel.h"
+#include "Thread.h"
+#include "Timestamp.h"
+#include "CurrentThread.h"
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <sys/syscall.h>
+
+std::atomic<bool> StallDetector::s_enabled_(false);
+std::atomic<int64_t> StallDetector::s_budgetMicros_(0);
+
+//所有的StallWatch，watchdog线程遍历时持有g_mutex
+static std::mutex g_mutex;
+static std::vector<StallWatch*> g_watches;
+static std::condition_variable g_cond;
+static bool g_stopWatchdog = false;
+static int g_signo = SIGPROF;
+static std::unique_ptr<Thread> g_watchdog;
+static StallDetector::ReportCallback g_reportCallback;
+
+//信号处理函数通过它找到当前loop线程的StallWatch
+static __thread StallWatch* t_watch = nullptr;
+
+static int64_t monotonicMicros()
+{
+	return Timestamp::monotonic().microSecondsSinceEpoch();
+}
+
+void StallDetector::enable(int64_t budgetMicros, bool sampleStacks, int signo)
+{
+	disable();
+	s_budgetMicros_.store(budgetMicros > 0 ? budgetMicros : 1, std::memory_order_relaxed);
+
+	if (sampleStacks)
+	{
+		//第一次调用backtrace会加载libgcc并分配内存，不能发生在信号处理函数中
+		void* frames[1];
+		::backtrace(frames, 1);
+
+		struct sigaction sa;
+		::memset(&sa, 0, sizeof sa);
+		sa.sa_handler = &StallWatch::handleSignal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		if (::sigaction(signo, &sa, nullptr) < 0)
+		{
+			LOG_ERROR("StallDetector::enable sigaction %d error:%d\n", signo, errno);
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(g_mutex);
+			g_signo = signo;
+			g_stopWatchdog = false;
+			g_watchdog.reset(new Thread(&StallDetector::watchdog, "StallWatchdog"));
+			g_watchdog->start();
+		}
+	}
+	s_enabled_.store(true, std::memory_order_relaxed);
+}
+
+void StallDetector::disable()
+{
+	s_enabled_.store(false, std::memory_order_relaxed);
+	std::unique_ptr<Thread> watchdog;
+	{
+		std::unique_lock<std::mutex> lock(g_mutex);
+		g_stopWatchdog = true;
+		g_cond.notify_all();
+		watchdog.swap(g_watchdog);
+	}
+	if (watchdog)
+	{
+		watchdog->join();
+	}
+}
+
+void StallDetector::setReportCallback(const ReportCallback& cb)
+{
+	g_reportCallback = cb;
+}
+
+void StallDetector::report(const StallReport& report)
+{
+	if (g_reportCallback)
+	{
+		g_reportCallback(report);
+		return;
+	}
+	LOG_ERROR("StallDetector - loop thread %d blocked %lld us in %s callback of %s\n", report.tid,
+		static_cast<long long>(report.micros), report.kind, report.target.c_str());
+	for (size_t i = 0; i < report.stack.size(); i++)
+	{
+		LOG_ERROR("    #%zu %s\n", i, report.stack[i].c_str());
+	}
+}
+
+//每隔预算的一半检查一次，最短1ms，最长100ms
+void StallDetector::watchdog()
+{
+	const int64_t budget = budgetMicros();
+	const int64_t period = std::min<int64_t>(std::max<int64_t>(budget / 2, 1000), 100 * 1000);
+	std::unique_lock<std::mutex> lock(g_mutex);
+	while (!g_stopWatchdog)
+	{
+		g_cond.wait_for(lock, std::chrono::microseconds(period));
+		if (g_stopWatchdog)
+		{
+			break;
+		}
+		int64_t now = monotonicMicros();
+		for (StallWatch* watch : g_watches)
+		{
+			watch->check(now, budget, g_signo);
+		}
+	}
+}
+
+StallWatch::StallWatch()
+	:tid_(CurrentThread::tid()), enterMicros_(0), sequence_(0), sampleRequest_(0), sampledSequence_(0), numFrames_(0)
+{
+	t_watch = this;
+	std::unique_lock<std::mutex> lock(g_mutex);
+	g_watches.push_back(this);
+}
+
+StallWatch::~StallWatch()
+{
+	{
+		std::unique_lock<std::mutex> lock(g_mutex);
+		g_watches.erase(std::remove(g_watches.begin(), g_watches.end(), this), g_watches.end());
+	}
+	if (t_watch == this)
+	{
+		t_watch = nullptr;
+	}
+}
+
+int64_t StallWatch::enter()
+{
+	sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	int64_t now = monotonicMicros();
+	enterMicros_.store(now, std::memory_order_release);
+	return now;
+}
+
+void StallWatch::leave(int64_t start, const char* kind, std::string (*describe)(const void*), const void* target)
+{
+	int64_t micros = monotonicMicros() - start;
+	//清0之后信号处理函数不会再修改frames_
+	enterMicros_.store(0, std::memory_order_release);
+	if (micros < StallDetector::budgetMicros())
+	{
+		return;
+	}
+
+	StallReport report;
+	report.tid = tid_;
+	report.kind = kind;
+	report.target = describe(target);
+	report.micros = micros;
+	if (sampledSequence_.load(std::memory_order_acquire) == sequence_.load(std::memory_order_relaxed) && numFrames_ > 0)
+	{
+		char** symbols = ::backtrace_symbols(frames_, numFrames_);
+		if (symbols != nullptr)
+		{
+			report.stack.assign(symbols, symbols + numFrames_);
+			::free(symbols);
+		}
+	}
+	StallDetector::report(report);
+}
+
+void StallWatch::check(int64_t now, int64_t budget, int signo)
+{
+	int64_t start = enterMicros_.load(std::memory_order_acquire);
+	if (start == 0 || now - start < budget)
+	{
+		return;
+	}
+	//先读enterMicros_再读sequence_，读到的可能是之后的回调，那个回调不超时就不会报告，多采样一次没有关系
+	uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+	if (sampleRequest_.load(std::memory_order_relaxed) == sequence)
+	{
+		return;
+	}
+	sampleRequest_.store(sequence, std::memory_order_release);
+	::syscall(SYS_tgkill, ::getpid(), tid_, signo);
+}
+
+//只做async-signal-safe的操作，backtrace已经在enable中预先加载过
+void StallWatch::handleSignal(int)
+{
+	StallWatch* watch = t_watch;
+	if (watch == nullptr || watch->enterMicros_.load(std::memory_order_relaxed) == 0)
+	{
+		return;
+	}
+	uint64_t sequence = watch->sequence_.load(std::memory_order_relaxed);
+	if (watch->sampleRequest_.load(std::memory_order_acquire) != sequence
+		|| watch->sampledSequence_.load(std::memory_order_relaxed) == sequence)
+	{
+		return;
+	}
+	int savedErrno = errno;
+	watch->numFrames_ = ::backtrace(watch->frames_, kMaxFrames);
+	watch->sampledSequence_.store(sequence, std::memory_order_release);
+	errno = savedErrno;
+}
+
+std::string StallGuard::describeChannel(const void* channel)
+{
+	return static_cast<const Channel*>(channel)->description();
+}
+
+//std::function保存的可调用对象的类型，lambda和bind的类型名里带有所在的函数
+std::string StallGuard::describeFunctor(const void* functor)
+{
+	const char* mangled = static_cast<const std::function<void()>*>(functor)->target_type().name();
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+	std::string name(status == 0 && demangled != nullptr ? demangled : mangled);
+	::free(demangled);
+	return name;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+class EventLoop;
+class Channel;
+
+//一次慢回调的报告
+struct StallReport
+{
+	pid_t tid;					//loop线程
+	const char* kind;			//"read" "write" "close" "error" "functor"
+	std::string target;			//Channel::description()或者回调的类型名
+	int64_t micros;				//回调执行的时间
+	std::vector<std::string> stack;	//采样模式下回调还在执行时的调用栈，没有采样到时为空
+};
+
+//慢回调检测 Channel::handleEventWithGuard和EventLoop::doPendingFunctors在每个回调前后记录时间
+//超过预算的回调在返回时由loop线程报告，默认用LOG_ERROR输出
+//采样模式下有一个watchdog线程，发现回调超过预算还没有返回时向loop线程发送信号，在信号处理函数中用backtrace记录调用栈
+//没有打开时每个回调只多一次relaxed读和一个分支
+class StallDetector :noncopyable
+{
+public:
+	using ReportCallback = std::function<void(const StallReport&)>;
+
+	//回调超过budgetMicros微秒时报告，sampleStacks为true时用signo采样调用栈，信号处理函数是进程全局的
+	//可以在任意线程调用，再次调用时替换之前的设置
+	static void enable(int64_t budgetMicros, bool sampleStacks = false, int signo = SIGPROF);
+	static void disable();
+
+	static bool enabled() { return s_enabled_.load(std::memory_order_relaxed); }
+	static int64_t budgetMicros() { return s_budgetMicros_.load(std::memory_order_relaxed); }
+
+	//报告在loop线程中执行，需要在enable之前设置
+	static void setReportCallback(const ReportCallback& cb);
+	static void report(const StallReport& report);
+
+private:
+	static void watchdog();
+
+	static std::atomic<bool> s_enabled_;
+	static std::atomic<int64_t> s_budgetMicros_;
+};
+
+//每个EventLoop一个，记录loop线程当前正在执行的回调，由watchdog线程读取
+//在loop线程中构造，只有loop线程调用enter/leave
+class StallWatch :noncopyable
+{
+public:
+	static const int kMaxFrames = 32;
+
+	StallWatch();
+	~StallWatch();
+
+	//返回进入的时间，单位微秒
+	int64_t enter();
+	//回调返回时调用，超过预算时用describe(target)描述回调并报告
+	void leave(int64_t start, const char* kind, std::string (*describe)(const void*), const void* target);
+
+private:
+	friend class StallDetector;
+
+	//watchdog线程调用，回调超过预算还没返回并且还没有采样过时发送信号
+	void check(int64_t now, int64_t budget, int signo);
+	static void handleSignal(int signo);
+
+	const pid_t tid_;
+	std::atomic<int64_t> enterMicros_;		//0表示没有在执行回调
+	std::atomic<uint64_t> sequence_;		//每次enter加一
+	std::atomic<uint64_t> sampleRequest_;	//watchdog要求采样的sequence
+	std::atomic<uint64_t> sampledSequence_;	//已经采样到调用栈的sequence
+	void* frames_[kMaxFrames];
+	int numFrames_;
+};
+
+//在作用域内记录一个回调的执行时间
+class StallGuard :noncopyable
+{
+public:
+	StallGuard(StallWatch* watch, const char* kind, const Channel* channel)
+		:watch_(StallDetector::enabled() ? watch : nullptr), kind_(kind), describe_(describeChannel), target_(channel)
+	{
+		if (watch_ != nullptr)
+		{
+			start_ = watch_->enter();
+		}
+	}
+
+	StallGuard(StallWatch* watch, const char* kind, const std::function<void()>* functor)
+		:watch_(StallDetector::enabled() ? watch : nullptr), kind_(kind), describe_(describeFunctor), target_(functor)
+	{
+		if (watch_ != nullptr)
+		{
+			start_ = watch_->enter();
+		}
+	}
+
+	~StallGuard()
+	{
+		if (watch_ != nullptr)
+		{
+			watch_->leave(start_, kind_, describe_, target_);
+		}
+	}
+
+private:
+	static std::string describeChannel(const void* channel);
+	static std::string describeFunctor(const void* functor);
+
+	StallWatch* watch_;
+	const char* kind_;
+	std::string (*describe_)(const void*);
+	const void* target_;
+	int64_t start_;
+};
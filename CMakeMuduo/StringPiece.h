@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+
+//只读的字符串视图，不持有数据 C++11里没有std::string_view
+//用来给const char*、std::string和(data, len)提供统一的参数类型，调用者要保证数据在使用期间有效
+class StringPiece
+{
+public:
+	StringPiece() :ptr_(nullptr), length_(0) {}
+	StringPiece(const char* str) :ptr_(str), length_(strlen(str)) {}
+	StringPiece(const std::string& str) :ptr_(str.data()), length_(str.size()) {}
+	StringPiece(const char* offset, size_t len) :ptr_(offset), length_(len) {}
+
+	const char* data() const { return ptr_; }
+	size_t size() const { return length_; }
+	bool empty() const { return length_ == 0; }
+
+	char operator[](size_t i) const { return ptr_[i]; }
+
+	void removePrefix(size_t n)
+	{
+		ptr_ += n;
+		length_ -= n;
+	}
+
+	std::string asString() const { return std::string(ptr_, length_); }
+
+	bool operator==(const StringPiece& rhs) const
+	{
+		return length_ == rhs.length_ && memcmp(ptr_, rhs.ptr_, length_) == 0;
+	}
+	bool operator!=(const StringPiece& rhs) const { return !(*this == rhs); }
+private:
+	const char* ptr_;
+	size_t length_;
+};
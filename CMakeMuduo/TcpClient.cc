@@ -0,0 +1,140 @@
+#include "TcpClient.h"
+#include "Logger.h"
+
+#include <sys/socket.h>
+#include <string.h>
+
+static EventLoop* CheckLoopNotNull(EventLoop* loop)
+{
+	if (loop == nullptr)
+	{
+		LOG_FATAL("%s:%s:%d TcpClient Loop is null \n", __FILE__, __FUNCTION__, __LINE__);
+	}
+	return loop;
+}
+
+//TcpClient析构之后连接才关闭时用的closeCallback
+static void removeDetachedConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+{
+	loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+static InetAddress getLocalAddr(int sockfd)
+{
+	sockaddr_in addr;
+	::memset(&addr, 0, sizeof addr);
+	socklen_t addrlen = sizeof addr;
+	if (::getsockname(sockfd, (sockaddr*)&addr, &addrlen) < 0)
+	{
+		LOG_ERROR("sockets::getLocalAddr\n");
+	}
+	return InetAddress(addr);
+}
+
+static InetAddress getPeerAddr(int sockfd)
+{
+	sockaddr_in addr;
+	::memset(&addr, 0, sizeof addr);
+	socklen_t addrlen = sizeof addr;
+	if (::getpeername(sockfd, (sockaddr*)&addr, &addrlen) < 0)
+	{
+		LOG_ERROR("sockets::getPeerAddr\n");
+	}
+	return InetAddress(addr);
+}
+
+TcpClient::TcpClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& nameArg)
+	:loop_(CheckLoopNotNull(loop)), connector_(new Connector(loop, serverAddr)), name_(nameArg),
+	connNamePrefix_(std::make_shared<const std::string>(nameArg + "-" + serverAddr.toIpPort() + "#")),
+	readBudget_(0), edgeTriggered_(false), retry_(false), connect_(false), nextConnId_(1)
+{
+	connector_->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+	LOG_INFO("TcpClient::TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient()
+{
+	LOG_INFO("TcpClient::~TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+	TcpConnectionPtr conn;
+	bool unique = false;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		unique = connection_.unique();
+		conn = connection_;
+	}
+
+	if (conn)
+	{
+		//连接还在，closeCallback不能再指向this
+		CloseCallback cb = std::bind(&removeDetachedConnection, loop_, std::placeholders::_1);
+		loop_->runInLoop(std::bind(&TcpConnection::setCloseCallback, conn, cb));
+		if (unique)
+		{
+			conn->forceClose();
+		}
+	}
+	else
+	{
+		//connector_的回调都持有shared_ptr，stop之后会自己释放
+		connector_->stop();
+	}
+}
+
+void TcpClient::connect()
+{
+	LOG_INFO("TcpClient::connect[%s] - connecting to %s\n", name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+	connect_ = true;
+	connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+	connect_ = false;
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (connection_)
+	{
+		connection_->shutdown();
+	}
+}
+
+void TcpClient::stop()
+{
+	connect_ = false;
+	connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+	InetAddress peerAddr(getPeerAddr(sockfd));
+	InetAddress localAddr(getLocalAddr(sockfd));
+
+	TcpConnectionPtr conn(new TcpConnection(loop_, nextConnId_++, connNamePrefix_, sockfd, localAddr, peerAddr));
+	conn->setConnectionCallback(connectionCallback_);
+	conn->setMessageCallback(messageCallback_);
+	conn->setWriteCompleteCallback(writeCompleteCallback_);
+	conn->setReadBudget(readBudget_);
+	conn->setEdgeTriggered(edgeTriggered_);
+	conn->setCloseCallback(std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		connection_ = conn;
+	}
+	conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr& conn)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		connection_.reset();
+	}
+
+	//现在还在channel的handleEvent中，等这一轮事件处理完再销毁
+	loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+	if (retry_ && connect_)
+	{
+		LOG_INFO("TcpClient::removeConnection[%s] - reconnecting to %s\n", name_.c_str(),
+			connector_->serverAddress().toIpPort().c_str());
+		connector_->restart();
+	}
+}
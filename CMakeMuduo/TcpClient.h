@@ -0,0 +1,73 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Connector.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+//对外的客户端编程使用的类 连接建立之后和TcpServer一样使用TcpConnection
+//一个TcpClient同一时间只有一个连接，所有回调都在loop线程中执行
+class TcpClient :noncopyable
+{
+public:
+	TcpClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& nameArg);
+	~TcpClient();
+
+	void connect();
+	//关闭当前连接的写端，不再重连
+	void disconnect();
+	//停止正在进行的连接
+	void stop();
+
+	//当前的连接，没有连接时为空
+	TcpConnectionPtr connection() const
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		return connection_;
+	}
+
+	EventLoop* getLoop() const { return loop_; }
+	bool retry() const { return retry_; }
+	//连接断开之后自动重连
+	void enableRetry() { retry_ = true; }
+	//连接失败时的重试间隔，见Connector::setRetryDelay
+	void setRetryDelay(int initialMs, int maxMs) { connector_->setRetryDelay(initialMs, maxMs); }
+	const std::string& name() const { return name_; }
+
+	void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb; }
+	void setMessageCallback(const MessageCallback& cb) { messageCallback_ = cb; }
+	void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
+	//见TcpConnection::setReadBudget
+	void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+	//连接使用边沿触发，需要在connect之前设置
+	void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+private:
+	//在loop线程中执行
+	void newConnection(int sockfd);
+	void removeConnection(const TcpConnectionPtr& conn);
+
+	EventLoop* loop_;
+	ConnectorPtr connector_;
+	const std::string name_;
+	const std::shared_ptr<const std::string> connNamePrefix_;
+
+	ConnectionCallback connectionCallback_;
+	MessageCallback messageCallback_;
+	WriteCompleteCallback writeCompleteCallback_;
+	size_t readBudget_;
+	bool edgeTriggered_;
+
+	std::atomic_bool retry_;
+	std::atomic_bool connect_;
+	uint64_t nextConnId_;	//只在loop线程中使用
+	mutable std::mutex mutex_;
+	TcpConnectionPtr connection_;	//由mutex_保护
+};
@@ -1,13 +1,21 @@
 #include "TcpConnection.h"
 #include "Logger.h"
 #include "EventLoop.h"
+#include "Tracer.h"
 
 #include <functional>
 #include <errno.h>
 #include <sys/socket.h>
 #include <string.h>
+#include <stdio.h>
 #include <netinet/tcp.h>
 
+//边沿触发模式下每次事件最多读写的字节数，避免一个连接占住loop
+static const size_t kDefaultEdgeBudget = 256 * 1024;
+
+//剩余数据不少于这个长度时，移动string到发送队列而不是拷贝
+static const size_t kMinMoveBytes = 1024;
+
 static EventLoop* CheckLoopNotNull(EventLoop* loop)
 {
 	if (loop == nullptr)
@@ -17,46 +25,147 @@ static EventLoop* CheckLoopNotNull(EventLoop* loop)
 	return loop;
 }
 
-TcpConnection::TcpConnection(EventLoop* loop, const std::string& nameArg, int sockfd, const InetAddress& localAddr,
-	const InetAddress& peerAddr):
+TcpConnection::TcpConnection(EventLoop* loop, uint64_t id, const std::shared_ptr<const std::string>& namePrefix, int sockfd,
+	const InetAddress& localAddr, const InetAddress& peerAddr):
 	loop_(CheckLoopNotNull(loop)), 
-	name_(nameArg), 
+	id_(id),
+	namePrefix_(namePrefix), 
 	state_(kConnecting),
 	reading_(true), 
 	socket_(new Socket(sockfd)), 
 	channel_(new Channel(loop, sockfd)), 
 	localAddr_(localAddr),
 	peerAddr_(peerAddr), 
-	highWaterMark_(64*1024*1024)	//64M
+	highWaterMark_(64*1024*1024),	//64M
+	readBudget_(0),
+	bytesReceived_(0),
+	bytesSent_(0),
+	idleTimeout_(0.0)
 {
 	//下面给channel设置相应的回调函数 poller监听到给channel通知感兴趣的事件发生了 ，channel会回调相应函数
 	channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
+	//只在channel的回调中调用，回调期间连接被tie住，this一直有效
+	channel_->setDescriber(std::bind(&TcpConnection::name, this));
 	channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
 	channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
 	channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
-	LOG_INFO("TcpConnection::ctor[%s] at %d\n", name_.c_str(), sockfd);
+	//默认级别下每个连接都会打印，只打印id，不拼接name
+	LOG_INFO("TcpConnection::ctor[#%llu] at %d\n", static_cast<unsigned long long>(id_), sockfd);
 	socket_->setKeepAlive(true);
+	//在构造时就计数，连接还没建立时选择subloop也能看到它
+	loop_->addConnections(1);
 }
 
 
 TcpConnection::~TcpConnection()
 {
-	LOG_INFO("TcpConnection::dtor[%s] at %d state=%d\n", name_.c_str(), channel_->fd(), (int)state_);
+	LOG_INFO("TcpConnection::dtor[#%llu] at %d state=%d\n", static_cast<unsigned long long>(id_), channel_->fd(), (int)state_);
+	loop_->addConnections(-1);
+}
+
+std::string TcpConnection::name() const
+{
+	char buf[32];
+	snprintf(buf, sizeof buf, "%llu", static_cast<unsigned long long>(id_));
+	return *namePrefix_ + buf;
 }
 
 //发送数据	数据=> json pb 发送
-void TcpConnection::send(const std::string& buf)
+//不在loop线程时先拷贝一份，调用者的数据在回调执行时可能已经不在了
+void TcpConnection::send(const void* data, size_t len)
 {
-	if (state_ = kConnected)
+	if (state_ == kConnected)
+	{
+		if (loop_->isInLoopThread())
+		{
+			sendInLoop(data, len);
+		}
+		else
+		{
+			std::string message(static_cast<const char*>(data), len);
+			loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(message)));
+		}
+	}
+}
+
+void TcpConnection::send(const StringPiece& message)
+{
+	send(message.data(), message.size());
+}
+
+void TcpConnection::send(const std::string& message)
+{
+	send(message.data(), message.size());
+}
+
+void TcpConnection::send(const char* message)
+{
+	send(message, strlen(message));
+}
+
+//把message移动到回调里，跨线程发送也不用拷贝
+void TcpConnection::send(std::string&& message)
+{
+	if (state_ == kConnected)
 	{
 		if (loop_->isInLoopThread())
 		{
-			sendInLoop(buf.c_str(), buf.size());
+			sendStringInLoop(message);
 		}
 		else
 		{
-			loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+			loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(message)));
+		}
+	}
+}
+
+//发送buf中所有可读的数据，发送后buf变为空
+//跨线程时把buf的内容交换到回调持有的Buffer中，不拷贝
+void TcpConnection::send(Buffer* buf)
+{
+	if (state_ == kConnected)
+	{
+		if (loop_->isInLoopThread())
+		{
+			sendBufferInLoop(buf);
+		}
+		else
+		{
+			std::shared_ptr<Buffer> owned(new Buffer(0));
+			owned->swap(*buf);
+			loop_->runInLoop(std::bind(&TcpConnection::sendOwnedBufferInLoop, shared_from_this(), owned));
+		}
+	}
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string>& message)
+{
+	if (state_ == kConnected)
+	{
+		if (loop_->isInLoopThread())
+		{
+			sendSharedInLoop(message);
+		}
+		else
+		{
+			loop_->runInLoop(std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), message));
+		}
+	}
+}
+
+//零拷贝发送文件 [offset, offset+length)，在outputQueue_中已有的数据之后发送
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+	if (state_ == kConnected)
+	{
+		if (loop_->isInLoopThread())
+		{
+			sendFileInLoop(fd, offset, length);
+		}
+		else
+		{
+			loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fd, offset, length));
 		}
 	}
 }
@@ -71,12 +180,27 @@ void TcpConnection::shutdown()
 	}
 }
 
+void TcpConnection::forceClose()
+{
+	if (state_ == kConnected || state_ == kDisconnecting)
+	{
+		setState(kDisconnecting);
+		loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+	}
+}
+
 //连接建立
 void TcpConnection::connectEstablished()
 {
 	setState(kConnected);
 	channel_->tie(shared_from_this());
 	channel_->enableReading();
+	if (idleTimeout_ > 0.0)
+	{
+		//时间轮回调时连接一定还在wheel里，说明连接还没销毁，可以直接用this
+		idleEntry_.setExpireCallback(std::bind(&TcpConnection::forceCloseInLoop, this));
+		loop_->timingWheel()->add(&idleEntry_, idleTimeout_);
+	}
 	//新连接建立，执行回调
 	connectionCallback_(shared_from_this());
 }
@@ -91,22 +215,54 @@ void TcpConnection::connectDestroyed()
 
 		connectionCallback_(shared_from_this());
 	}
+	if (idleEntry_.linked())
+	{
+		loop_->timingWheel()->remove(&idleEntry_);
+	}
 	//把channel从poller中删除
 	channel_->remove();
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+	TraceScope trace("TcpConnection::handleRead", channel_->fd());
 	int savedErrno = 0;
-	size_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+	ssize_t n = 0;
+	if (channel_->edgeTriggered())
+	{
+		n = inputBuffer_.readFdUntilBlocked(channel_->fd(), readBudget_ > 0 ? readBudget_ : kDefaultEdgeBudget, &savedErrno);
+	}
+	else if (readBudget_ > 0)
+	{
+		n = inputBuffer_.readFdUntilBlocked(channel_->fd(), readBudget_, &savedErrno);
+	}
+	else
+	{
+		n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+	}
+	trace.setResult(n);
+
 	if (n > 0)
 	{
+		bytesReceived_ += n;
+		loop_->metrics().addBytesIn(n);
+		//O(1)的操作，只记录最后活跃的tick
+		idleEntry_.touch();
 		messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+		//边沿触发模式下没有读到EAGAIN就不会再有通知，让其他连接先处理，下一轮pendingFunctors再继续读
+		if (channel_->edgeTriggered() && savedErrno != EAGAIN)
+		{
+			loop_->queueInLoop(std::bind(&TcpConnection::continueReading, shared_from_this()));
+		}
 	}
 	else if (n == 0)
 	{
 		handleClose();
 	}
+	else if (savedErrno == EAGAIN || savedErrno == EINTR)
+	{
+		//没有数据可读，等下一次可读事件
+	}
 	else
 	{
 		errno = savedErrno;
@@ -117,30 +273,39 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 
 void TcpConnection::handleWrite()
 {
+	TraceScope trace("TcpConnection::handleWrite", channel_->fd());
 	if (channel_->isWriting())
 	{
+		//outputQueue_中的内存分段用writev合并发送，文件分段用sendfile
 		int savedErrno = 0;
-		ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+		size_t budget = channel_->edgeTriggered() ? kDefaultEdgeBudget : SIZE_MAX;
+		ssize_t n = outputQueue_.writeTo(channel_->fd(), &savedErrno, budget);
+		trace.setResult(n);
 		if (n > 0)
 		{
-			outputBuffer_.retrieve(n);
-			if (outputBuffer_.readableBytes() == 0)
+			addBytesSent(n);
+		}
+		if (n < 0)
+		{
+			handleWriteError("handleWrite", savedErrno);
+		}
+		else if (outputQueue_.empty())
+		{
+			channel_->disableWriting();
+			if (writeCompleteCallback_)
 			{
-				channel_->disableWriting();
-				if (writeCompleteCallback_)
-				{
-					//唤醒loop所在的线程，执行回调
-					loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-				}
+				//唤醒loop所在的线程，执行回调
+				loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
 			}
 			if (state_ == kDisconnecting)
 			{
 				shutdownInLoop();
 			}
 		}
-		else
+		else if (static_cast<size_t>(n) >= budget)
 		{
-			LOG_ERROR("TcpConnection::handleWrite error\n");
+			//边沿触发模式下用完了这一轮的额度，内核缓冲区可能还没满，不会再有可写通知
+			loop_->queueInLoop(std::bind(&TcpConnection::continueWriting, shared_from_this()));
 		}
 	}
 	else
@@ -149,11 +314,31 @@ void TcpConnection::handleWrite()
 	}
 }
 
+void TcpConnection::continueReading()
+{
+	if (state_ == kConnected || state_ == kDisconnecting)
+	{
+		handleRead(Timestamp::now());
+	}
+}
+
+void TcpConnection::continueWriting()
+{
+	if (channel_->isWriting())
+	{
+		handleWrite();
+	}
+}
+
 void TcpConnection::handleClose()
 {
 	LOG_INFO("fd=%d state=%d \n", channel_->fd(), (int)state_);
 	setState(kDisconnected);
 	channel_->disableAll();
+	if (idleEntry_.linked())
+	{
+		loop_->timingWheel()->remove(&idleEntry_);
+	}
 
 	TcpConnectionPtr connPtr(shared_from_this());
 	connectionCallback_(connPtr);	//执行连接关闭的回调
@@ -176,63 +361,220 @@ void TcpConnection::handleError()
 	LOG_ERROR("TcpConnection::handleError()");
 }
 
+void TcpConnection::addBytesSent(size_t n)
+{
+	bytesSent_ += n;
+	loop_->metrics().addBytesOut(n);
+}
+
+//没有待发送的数据时直接write，返回写入的字节数
+size_t TcpConnection::writeDirectly(const char* data, size_t len, bool* faultError)
+{
+	//channel正在等待epollout，或者队列里还有数据，直接写会打乱顺序
+	if (channel_->isWriting() || !outputQueue_.empty())
+	{
+		return 0;
+	}
+
+	ssize_t nwrote = ::write(channel_->fd(), data, len);
+	if (nwrote >= 0)
+	{
+		addBytesSent(nwrote);
+		//一次性数据发送完成，就不用再给channel设置epollout事件了
+		if (static_cast<size_t>(nwrote) == len && writeCompleteCallback_)
+		{
+			loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+		}
+		return nwrote;
+	}
+
+	if (errno != EWOULDBLOCK)
+	{
+		LOG_ERROR("TcpConnection::writeDirectly error:%d\n", errno);
+		if (errno == EPIPE || errno == ECONNRESET)
+		{
+			*faultError = true;
+		}
+	}
+	return 0;
+}
+
 //发送数据 应用写的快，内核发送数据慢 需要把待发送数据写入缓冲区，而且设置了水位回调,防止发送太快
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
-	ssize_t nwrote = 0;
-	size_t remaining = len;
+	TraceScope trace("TcpConnection::sendInLoop", static_cast<int64_t>(len));
+	if (state_ == kDisconnected)
+	{
+		LOG_ERROR("disconnected, give up writing\n");
+		return;
+	}
+
 	bool faultError = false;
+	size_t nwrote = writeDirectly(static_cast<const char*>(data), len, &faultError);
+	trace.setResult(static_cast<int64_t>(nwrote));
 
+	//这一次write并没有把数据完全发送出去，需要把数据保存在缓冲区中，给channel注册epollout事件
+	//poller发现发送缓冲区有空间，通知channel调用handlewrite回调
+	//也就是调用tcpconnection::handlewrite方法把发送缓冲区中数据全部发送完成
+	if (!faultError && nwrote < len)
+	{
+		size_t oldLen = outputQueue_.memoryBytes();
+		outputQueue_.append(static_cast<const char*>(data) + nwrote, len - nwrote);
+		waitForWritable(oldLen);
+	}
+}
+
+//和sendInLoop一样，但剩下的数据较多时把message整个移动到队列里，不再拷贝
+void TcpConnection::sendStringInLoop(std::string& message)
+{
+	TraceScope trace("TcpConnection::sendStringInLoop", static_cast<int64_t>(message.size()));
 	if (state_ == kDisconnected)
 	{
 		LOG_ERROR("disconnected, give up writing\n");
 		return;
 	}
 
-	//channel第一次开始写数据，而且缓冲区没有待发送数据
-	if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+	bool faultError = false;
+	size_t len = message.size();
+	size_t nwrote = writeDirectly(message.data(), len, &faultError);
+	trace.setResult(static_cast<int64_t>(nwrote));
+	if (!faultError && nwrote < len)
 	{
-		nwrote = ::write(channel_->fd(), data, len);
-		if (nwrote >= 0)
+		size_t oldLen = outputQueue_.memoryBytes();
+		size_t remaining = len - nwrote;
+		if (remaining < kMinMoveBytes)
 		{
-			remaining = len - nwrote;
-			//一次性数据发送完成，就不用再给channel设置epollout事件了
-			if (remaining == 0 && writeCompleteCallback_)
-			{
-				loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-			}
+			outputQueue_.append(message.data() + nwrote, remaining);
 		}
 		else
 		{
-			nwrote = 0;
-			if (errno != EWOULDBLOCK)
-			{
-				LOG_ERROR("TcpConnection::sendInLoop error!");
-				if (errno == EPIPE || errno == ECONNRESET)
-				{
-					faultError = true;
-				}
-			}
+			OutputQueue::SharedString owned(new std::string(std::move(message)));
+			outputQueue_.append(owned, nwrote, remaining);
 		}
+		waitForWritable(oldLen);
 	}
+}
 
-	//这一次write并没有把数据完全发送出去，需要把数据保存在缓冲区中，给channel注册epollout事件
-	//poller发现发送缓冲区有空间，通知channel调用handlewrite回调
-	//也就是调用tcpconnection::handlewrite方法把发送缓冲区中数据全部发送完成
-	if (!faultError && remaining > 0)
+//剩下的数据直接和队列里的Buffer交换，不拷贝
+void TcpConnection::sendBufferInLoop(Buffer* buf)
+{
+	TraceScope trace("TcpConnection::sendBufferInLoop", static_cast<int64_t>(buf->readableBytes()));
+	if (state_ == kDisconnected)
 	{
-		//发送缓冲区待发送数据长度
-		size_t oldLen = outputBuffer_.readableBytes();
-		if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_&&highWaterMarkCallback_)
+		LOG_ERROR("disconnected, give up writing\n");
+		return;
+	}
+
+	bool faultError = false;
+	size_t nwrote = writeDirectly(buf->peek(), buf->readableBytes(), &faultError);
+	trace.setResult(static_cast<int64_t>(nwrote));
+	buf->retrieve(nwrote);
+	if (faultError)
+	{
+		buf->retrieveAll();
+	}
+	else if (buf->readableBytes() > 0)
+	{
+		size_t oldLen = outputQueue_.memoryBytes();
+		outputQueue_.append(buf);
+		waitForWritable(oldLen);
+	}
+}
+
+void TcpConnection::sendOwnedBufferInLoop(const std::shared_ptr<Buffer>& buf)
+{
+	sendBufferInLoop(buf.get());
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+	if (state_ == kConnected || state_ == kDisconnecting)
+	{
+		LOG_INFO("TcpConnection::forceCloseInLoop [#%llu] fd=%d\n", static_cast<unsigned long long>(id_), channel_->fd());
+		handleClose();
+	}
+}
+
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const std::string>& message)
+{
+	if (state_ == kDisconnected)
+	{
+		LOG_ERROR("disconnected, give up writing\n");
+		return;
+	}
+
+	size_t oldLen = outputQueue_.memoryBytes();
+	outputQueue_.append(message, 0, message->size());
+	flushOrQueue(oldLen);
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+	if (state_ == kDisconnected)
+	{
+		LOG_ERROR("disconnected, give up sending file\n");
+		return;
+	}
+
+	size_t oldLen = outputQueue_.memoryBytes();
+	outputQueue_.appendFile(fd, offset, length);
+	flushOrQueue(oldLen);
+}
+
+//新的分段已经加入outputQueue_，没有在等待epollout就先尝试直接发送，剩下的注册写事件
+void TcpConnection::flushOrQueue(size_t oldLen)
+{
+	if (!channel_->isWriting())
+	{
+		int savedErrno = 0;
+		ssize_t n = outputQueue_.writeTo(channel_->fd(), &savedErrno);
+		if (n > 0)
 		{
-			loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+			addBytesSent(n);
 		}
-		outputBuffer_.append((char*)data + nwrote, remaining);
-		if (!channel_->isWriting())
+		else if (n < 0)
 		{
-			//注册channel的写事件
-			channel_->enableWriting();
+			handleWriteError("flushOrQueue", savedErrno);
+			return;
 		}
+		if (outputQueue_.empty())
+		{
+			if (writeCompleteCallback_)
+			{
+				loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+			}
+			return;
+		}
+	}
+
+	waitForWritable(oldLen);
+}
+
+//writeTo返回-1时是EAGAIN和EINTR之外的错误，出错的分段还在队头，再写也一样会失败
+//例如sendfile的EINVAL、文件已经被关闭的EBADF，继续等待epollout的话LT模式下loop会一直空转，所以关闭写事件并关闭连接
+void TcpConnection::handleWriteError(const char* where, int savedErrno)
+{
+	LOG_ERROR("TcpConnection::%s fd=%d error:%d\n", where, channel_->fd(), savedErrno);
+	if (channel_->isWriting())
+	{
+		channel_->disableWriting();
+	}
+	//可能在用户的send中，不在这里同步执行关闭的回调
+	loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+}
+
+//outputQueue_从oldLen增长后，检查高水位并注册channel的写事件
+void TcpConnection::waitForWritable(size_t oldLen)
+{
+	size_t newLen = outputQueue_.memoryBytes();
+	if (newLen >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+	{
+		loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+	}
+	if (!channel_->isWriting())
+	{
+		//注册channel的写事件
+		channel_->enableWriting();
 	}
 }
 
@@ -4,13 +4,17 @@
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "OutputQueue.h"
+#include "StringPiece.h"
 #include "Timestamp.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "TimingWheel.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <stdint.h>
 
 class EventLoop;
 
@@ -19,22 +23,47 @@ class EventLoop;
 class TcpConnection:noncopyable,public std::enable_shared_from_this<TcpConnection>
 {
 public:
-	TcpConnection(EventLoop* loop, const std::string& nameArg, int sockfd, const InetAddress& localAddr,
-		const InetAddress& peerAddr);
+	//namePrefix由创建者共享，name()为namePrefix加上id，只在调用时才拼接
+	TcpConnection(EventLoop* loop, uint64_t id, const std::shared_ptr<const std::string>& namePrefix, int sockfd,
+		const InetAddress& localAddr, const InetAddress& peerAddr);
 	~TcpConnection();
 
 	EventLoop* getLoop() const { return loop_; }
-	const std::string& name() const { return name_; }
+	//在创建者内唯一
+	uint64_t id() const { return id_; }
+	//每次调用都会生成一个新的字符串，用于日志等，不要在热路径上用作key
+	std::string name() const;
 	const InetAddress& localAddress() const { return localAddr_; }
 	const InetAddress& peerAddress() const { return peerAddr_; }
 
+	//这个连接读到和写出的字节数，只在loop线程中读取才是准确的
+	uint64_t bytesReceived() const { return bytesReceived_; }
+	uint64_t bytesSent() const { return bytesSent_; }
+
 	bool connected() const { return state_ == kConnected; }
 	bool disconnected() const { return state_ == kDisconnected; }
 
-	//发送数据
-	void send(const std::string& buf);
+	//发送数据 在loop线程中调用时不拷贝，直接写socket，写不完的部分才放入发送队列
+	//在其他线程中调用时会先拷贝一份再交给loop线程
+	void send(const void* data, size_t len);
+	void send(const StringPiece& message);
+	void send(const std::string& message);
+	void send(const char* message);
+	//message的所有权转移给连接，跨线程发送时不拷贝
+	void send(std::string&& message);
+	//发送buf中所有的可读数据，发送后buf为空，写不完的部分和发送队列交换，不拷贝
+	void send(Buffer* buf);
+	//发送引用计数的字符串，队列里只保存引用，不拷贝数据
+	//在发送完之前message的内容不能再修改
+	void send(const std::shared_ptr<const std::string>& message);
+	//用sendfile零拷贝发送文件fd中[offset, offset+length)的内容
+	//在之前send的数据之后发送，fd由调用者管理，需要保持打开直到WriteCompleteCallback
+	//文件区间不占内存，不计入高水位
+	void sendFile(int fd, off_t offset, size_t length);
 	//关闭当前连接
 	void shutdown();
+	//强制关闭当前连接，不等待发送缓冲区中的数据
+	void forceClose();
 
 	void setConnectionCallback(const ConnectionCallback& cb)
 	{
@@ -52,11 +81,26 @@ public:
 	{
 		closeCallback_ = cb;
 	}
+	//待发送的内存数据超过highWaterMark时回调
 	void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
 	{
 		highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark;
 	}
 
+	//每次可读事件最多读取bytes字节，一直读到内核缓冲区读空为止，减少poll的次数
+	//0表示每次可读事件只调用一次read
+	void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+
+	//使用边沿触发，需要在connectEstablished之前设置
+	//每次事件最多读写readBudget(默认256k)字节，没有读写完的部分通过queueInLoop在下一轮继续
+	void setEdgeTriggered(bool on) { channel_->setEdgeTriggered(on); }
+
+	//关闭Nagle算法，小的请求马上发出
+	void setTcpNoDelay(bool on) { socket_->setTcpNoDelay(on); }
+
+	//超过seconds秒没有收到数据就关闭连接，需要在connectEstablished之前设置
+	void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+
 	//连接建立
 	void connectEstablished();
 	//连接销毁
@@ -71,13 +115,27 @@ private:
 	void handleWrite();
 	void handleClose();
 	void handleError();
+	void continueReading();
+	void continueWriting();
 
+	void addBytesSent(size_t n);
+	size_t writeDirectly(const char* data, size_t len, bool* faultError);
 	void sendInLoop(const void* data, size_t len);
+	void sendStringInLoop(std::string& message);
+	void sendBufferInLoop(Buffer* buf);
+	void sendOwnedBufferInLoop(const std::shared_ptr<Buffer>& buf);
+	void sendSharedInLoop(const std::shared_ptr<const std::string>& message);
+	void sendFileInLoop(int fd, off_t offset, size_t length);
+	void flushOrQueue(size_t oldLen);
+	void waitForWritable(size_t oldLen);
+	void handleWriteError(const char* where, int savedErrno);
 	void shutdownInLoop();
+	void forceCloseInLoop();
 
 
 	EventLoop* loop_;	//这里绝对不是baseloop，因为TcpConnection都是在subloop里面管理的
-	const std::string name_;
+	const uint64_t id_;
+	std::shared_ptr<const std::string> namePrefix_;
 	std::atomic_int state_;
 	bool reading_;
 
@@ -98,6 +156,14 @@ private:
 	HighWaterMarkCallback highWaterMarkCallback_;
 	size_t highWaterMark_;
 
+	size_t readBudget_;	//每次可读事件最多读取的字节数 0表示只读一次
+
 	Buffer inputBuffer_;	//接收数据的缓冲区
-	Buffer outputBuffer_;	//发送数据的缓冲区
+	OutputQueue outputQueue_;	//发送队列 内存数据和文件按顺序排队
+
+	uint64_t bytesReceived_;
+	uint64_t bytesSent_;
+
+	double idleTimeout_;	//空闲超时时间 0表示不检测
+	TimingWheel::Entry idleEntry_;	//在loop的时间轮中的位置
 };
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "TcpServer.h"
 #include "Logger.h"
+#include "CpuAffinity.h"
+
+#include <future>
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop)
 {
@@ -11,10 +14,11 @@ static EventLoop* CheckLoopNotNull(EventLoop* loop)
 }
 
 TcpServer::TcpServer(EventLoop* loop, const InetAddress& listenAddr, const std::string& nameArg, Option option)
-	:loop_(CheckLoopNotNull(loop)), ipPort_(listenAddr.toIpPort()), name_(nameArg), 
-	acceptor_(new Acceptor(loop, listenAddr, option = kReusePort)), 
+	:loop_(CheckLoopNotNull(loop)), ipPort_(listenAddr.toIpPort()), name_(nameArg),
+	connNamePrefix_(std::make_shared<const std::string>(nameArg + "-" + ipPort_ + "#")), option_(option),
+	acceptor_(new Acceptor(loop, listenAddr, option != kNoReusePort)), 
 	threadPool_(new EventLoopThreadPool(loop, name_)), connectionCallback_(),
-	messageCallback_(),	nextConnId_(1), started_(0)
+	messageCallback_(),	nextConnId_(1), started_(0), idleTimeout_(0.0), readBudget_(0), edgeTriggered_(false)
 {
 	//当有新用户连接时，会执行TcpServer::newConnection回调
 	acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1,
@@ -23,15 +27,24 @@ TcpServer::TcpServer(EventLoop* loop, const InetAddress& listenAddr, const std::
 
 TcpServer::~TcpServer()
 {
-	for (auto& item : connections_)
+	//每个shard在自己的loop中先析构Acceptor再销毁连接，并等它做完
+	//Acceptor的回调绑定了this，先停止accept，之后accept的连接才不会漏掉
+	//subloop随threadPool_退出，只投递不等的话可能来不及执行
+	for (size_t i = 0; i < shards_.size(); i++)
 	{
-		//当conn出了右括号 即可释放TcpConnection
-		TcpConnectionPtr conn(item.second);
-		item.second.reset();    // 把原始的智能指针复位
-
-		// 销毁连接
-		conn->getLoop()->runInLoop(
-			std::bind(&TcpConnection::connectDestroyed, conn));
+		ConnectionShardPtr shard = shards_[i];
+		Acceptor* acceptor = i < ioAcceptors_.size() ? ioAcceptors_[i].release() : nullptr;
+		if (shard->loop->isInLoopThread())
+		{
+			destroyShardInLoop(shard, acceptor);
+			continue;
+		}
+		std::promise<void> done;
+		shard->loop->queueInLoop([shard, acceptor, &done]() {
+			destroyShardInLoop(shard, acceptor);
+			done.set_value();
+		});
+		done.get_future().wait();
 	}
 }
 
@@ -41,6 +54,24 @@ void TcpServer::setThreadNum(int numThreads)
 	threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setEdgeTriggered(bool on)
+{
+	edgeTriggered_ = on;
+	acceptor_->setEdgeTriggered(on);
+}
+
+bool TcpServer::setCpuAffinityFromNic(const std::string& ifname)
+{
+	std::vector<int> cpus = CpuAffinity::nicIrqCpus(ifname);
+	if (cpus.empty())
+	{
+		LOG_ERROR("TcpServer::setCpuAffinityFromNic[%s] - no irq found for %s\n", name_.c_str(), ifname.c_str());
+		return false;
+	}
+	threadPool_->setCpuAffinity(cpus);
+	return true;
+}
+
 //开启服务器监听  loop.loop()
 void TcpServer::start()
 {
@@ -48,23 +79,75 @@ void TcpServer::start()
 	if (started_++ == 0)
 	{
 		//启动底层线程池
-		threadPool_->start();
-		//
-		loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+		threadPool_->start(threadInitCallback_);
+
+		std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+		for (EventLoop* ioLoop : loops)
+		{
+			ConnectionShardPtr shard = std::make_shared<ConnectionShard>();
+			shard->loop = ioLoop;
+			shards_.push_back(shard);
+		}
+
+		if (option_ == kReusePortPerLoop && loops[0] != loop_)
+		{
+			//每个subloop绑定同一个地址，构造时已经设置了SO_REUSEPORT
+			//baseloop的acceptor_只占住端口，不listen，内核不会把连接分给它
+			InetAddress listenAddr(acceptor_->localAddress());
+			for (const ConnectionShardPtr& shard : shards_)
+			{
+				Acceptor* acceptor = new Acceptor(shard->loop, listenAddr, true);
+				acceptor->setEdgeTriggered(edgeTriggered_);
+				acceptor->setMaxAcceptsPerEvent(acceptor_->maxAcceptsPerEvent());
+				acceptor->setNewConnectionCallback(std::bind(&TcpServer::newConnectionInIoLoop, this, shard,
+					std::placeholders::_1, std::placeholders::_2));
+				ioAcceptors_.emplace_back(acceptor);
+				shard->loop->runInLoop(std::bind(&Acceptor::listen, acceptor));
+			}
+		}
+		else
+		{
+			loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+		}
 	}
 }
 
 //有一个新客户端连接，acceptor就会执行这个回调
 void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 {
-	//轮询算法，选择一个subloop来管理channel
-	EventLoop* ioLoop = threadPool_->getNextLoop();
-	char buf[64] = { 0 };
-	snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-	++nextConnId_;
-	std::string connName = name_ + buf;
-	LOG_INFO("TcpServer::newConnection[%s]	- new connection [%s] from %s\n", 
-		name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
+	//按设置的策略选择一个subloop来管理channel，一致性哈希只用ip，同一个客户端的连接落到同一个loop
+	EventLoop* ioLoop = threadPool_->getNextLoop(peerAddr.getSockAddr()->sin_addr.s_addr);
+	const ConnectionShardPtr& shard = shardOf(ioLoop);
+	TcpConnectionPtr conn = createConnection(shard, sockfd, peerAddr);
+	ioLoop->runInLoop(std::bind(&TcpServer::connectEstablishedInLoop, shard, conn));
+}
+
+//在shard的loop中执行，连接不经过baseloop
+void TcpServer::newConnectionInIoLoop(const ConnectionShardPtr& shard, int sockfd, const InetAddress& peerAddr)
+{
+	TcpConnectionPtr conn = createConnection(shard, sockfd, peerAddr);
+	connectEstablishedInLoop(shard, conn);
+}
+
+//loop个数很少，顺序查找比哈希更快
+const TcpServer::ConnectionShardPtr& TcpServer::shardOf(EventLoop* ioLoop) const
+{
+	for (const ConnectionShardPtr& shard : shards_)
+	{
+		if (shard->loop == ioLoop)
+		{
+			return shard;
+		}
+	}
+	LOG_FATAL("%s:%s:%d loop %p not in server %s\n", __FILE__, __FUNCTION__, __LINE__, ioLoop, name_.c_str());
+	return shards_.front();
+}
+
+TcpConnectionPtr TcpServer::createConnection(const ConnectionShardPtr& shard, int sockfd, const InetAddress& peerAddr)
+{
+	uint64_t id = nextConnId_++;
+	LOG_INFO("TcpServer::newConnection[%s]	- new connection [%s%llu] from %s\n", 
+		name_.c_str(), connNamePrefix_->c_str(), static_cast<unsigned long long>(id), peerAddr.toIpPort().c_str());
 
 	//通过sockfd获取其绑定的本机ip地址和端口信息
 	sockaddr_in local;
@@ -77,29 +160,44 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 	InetAddress localAddr(local);
 
 	//根据连接成功的fd创建TcpConnection
-	TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-	connections_[connName] = conn;
+	TcpConnectionPtr conn(new TcpConnection(shard->loop, id, connNamePrefix_, sockfd, localAddr, peerAddr));
 	//用户设置给TcpServer=》TcpConnection=》Channel
 	conn->setConnectionCallback(connectionCallback_);
 	conn->setWriteCompleteCallback(writeCompleteCallback_);
 	conn->setMessageCallback(messageCallback_);
+	conn->setIdleTimeout(idleTimeout_);
+	conn->setReadBudget(readBudget_);
+	conn->setEdgeTriggered(edgeTriggered_);
 
-	//设置如何关闭连接的回调
-	conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-	//直接调用cpConnection::connectEstablished
-	ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+	//设置如何关闭连接的回调，在连接所在的loop中从shard删除
+	conn->setCloseCallback(std::bind(&TcpServer::removeConnection, shard, std::placeholders::_1));
+	return conn;
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr& conn)
+void TcpServer::connectEstablishedInLoop(const ConnectionShardPtr& shard, const TcpConnectionPtr& conn)
 {
-	loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+	shard->connections[conn->id()] = conn;
+	conn->connectEstablished();
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
+//在连接所在的loop中执行
+void TcpServer::removeConnection(const ConnectionShardPtr& shard, const TcpConnectionPtr& conn)
 {
-	LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n", name_.c_str(), conn->name().c_str());
-	size_t n = connections_.erase(conn->name());
+	LOG_INFO("TcpServer::removeConnection - connection #%llu\n", static_cast<unsigned long long>(conn->id()));
+	shard->connections.erase(conn->id());
 
-	EventLoop* ioLoop = conn->getLoop();
-	ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
-}
\ No newline at end of file
+	//现在还在channel的handleEvent中，等这一轮事件处理完再销毁
+	shard->loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+void TcpServer::destroyShardInLoop(const ConnectionShardPtr& shard, Acceptor* acceptor)
+{
+	delete acceptor;
+
+	ConnectionMap connections;
+	connections.swap(shard->connections);
+	for (auto& item : connections)
+	{
+		item.second->connectDestroyed();
+	}
+}
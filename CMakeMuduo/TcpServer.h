@@ -16,6 +16,8 @@
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <vector>
+#include <stdint.h>
 
 
 //对外的服务器编程使用的类
@@ -28,6 +30,9 @@ public:
 	{
 		kNoReusePort,
 		kReusePort,
+		//每个subloop一个监听socket和Acceptor，由内核通过SO_REUSEPORT分配新连接，baseloop不参与accept
+		//这个模式下setPlacement不起作用
+		kReusePortPerLoop,
 	};
 
 	TcpServer(EventLoop* loop, const InetAddress& listenAddr, const std::string& nameArg, Option option = kNoReusePort);
@@ -39,30 +44,72 @@ public:
 	void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb; }
 	void setMessageCallback(const MessageCallback& cb) { messageCallback_ = cb; }
 	void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
+	//连接超过seconds秒没有收到数据就关闭，由每个subloop的时间轮检测，0表示不检测
+	void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+	//监听socket和所有连接都使用边沿触发，需要在start之前设置
+	void setEdgeTriggered(bool on);
+	//每次可读事件最多读取的字节数，0表示只读一次，见TcpConnection::setReadBudget
+	void setReadBudget(size_t bytes) { readBudget_ = bytes; }
+	//新连接选择subloop的策略，默认轮询，kConsistentHash按对端ip选择
+	void setPlacement(EventLoopThreadPool::Placement placement) { threadPool_->setPlacement(placement); }
+	//第i个subloop绑定到cpus[i % cpus.size()]，loop的内存从本地NUMA节点分配，需要在start之前设置
+	void setCpuAffinity(const std::vector<int>& cpus) { threadPool_->setCpuAffinity(cpus); }
+	//按网卡ifname的中断所在的cpu绑定subloop，让处理连接的线程和收包的软中断在同一个核上
+	//找不到网卡的中断时返回false，不绑定
+	bool setCpuAffinityFromNic(const std::string& ifname);
+	//每次监听socket可读时最多accept的连接数，需要在start之前设置
+	void setMaxAcceptsPerEvent(int n) { acceptor_->setMaxAcceptsPerEvent(n); }
 
 
 	//开启服务器监听
 	void start();
 
+	//start之后可以用threadPool()->getAllLoops()取得所有subloop，例如用LoopMetrics::collect汇总统计
+	std::shared_ptr<EventLoopThreadPool> threadPool() const { return threadPool_; }
+
 private:
+	using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>;
+
+	//每个loop自己的连接表，只在这个loop的线程中访问，连接的建立和销毁都不经过baseloop
+	//连接的closeCallback持有shared_ptr，TcpServer析构之后关闭的连接也能安全地从表中删除
+	struct ConnectionShard
+	{
+		EventLoop* loop;
+		ConnectionMap connections;
+	};
+	using ConnectionShardPtr = std::shared_ptr<ConnectionShard>;
+
+	//baseloop的Acceptor收到新连接，按placement选择subloop
 	void newConnection(int sockfd, const InetAddress& peerAddr);
-	void removeConnection(const TcpConnectionPtr& conn);
-	void removeConnectionInLoop(const TcpConnectionPtr& conn);
+	//subloop自己的Acceptor收到新连接，直接在shard的loop中建立
+	void newConnectionInIoLoop(const ConnectionShardPtr& shard, int sockfd, const InetAddress& peerAddr);
+	TcpConnectionPtr createConnection(const ConnectionShardPtr& shard, int sockfd, const InetAddress& peerAddr);
+	const ConnectionShardPtr& shardOf(EventLoop* ioLoop) const;
 
-	using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+	static void connectEstablishedInLoop(const ConnectionShardPtr& shard, const TcpConnectionPtr& conn);
+	static void removeConnection(const ConnectionShardPtr& shard, const TcpConnectionPtr& conn);
+	//析构时在shard的loop中执行，acceptor是这个loop的Acceptor，可以为空
+	static void destroyShardInLoop(const ConnectionShardPtr& shard, Acceptor* acceptor);
 
 	//baseloop
 	EventLoop* loop_;
 
 	const std::string ipPort_;
 	const std::string name_;
+	//连接名字的前缀 name-ip:port#，所有连接共享
+	const std::shared_ptr<const std::string> connNamePrefix_;
 	
+	const Option option_;
+
 	//mainloop
 	std::unique_ptr<Acceptor> acceptor_;
 
 	//one loop per thread
 	std::shared_ptr<EventLoopThreadPool> threadPool_;
 
+	//kReusePortPerLoop模式下每个subloop的Acceptor，和shards_一一对应，只能在各自的loop中析构
+	std::vector<std::unique_ptr<Acceptor>> ioAcceptors_;
+
 	//新连接的回调
 	ConnectionCallback connectionCallback_;
 	//读写消息的回调
@@ -74,6 +121,9 @@ private:
 	ThreadInitCallback threadInitCallback_;
 
 	std::atomic_int started_;
-	int nextConnId_;
-	ConnectionMap connections_;
+	std::atomic<uint64_t> nextConnId_;	//kReusePortPerLoop模式下多个subloop同时分配
+	double idleTimeout_;
+	size_t readBudget_;
+	bool edgeTriggered_;
+	std::vector<ConnectionShardPtr> shards_;	//和threadPool_->getAllLoops()一一对应，start之后不再修改
 };
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+
+#include <atomic>
+
+//定时器 记录超时时间、回调以及是否重复
+class Timer :noncopyable
+{
+public:
+	Timer(TimerCallback cb, Timestamp when, double interval)
+		:callback_(std::move(cb)),
+		expiration_(when),
+		interval_(interval),
+		repeat_(interval > 0.0),
+		sequence_(++s_numCreated_),
+		heapIndex_(kNotInHeap)
+	{}
+
+	void run() const { callback_(); }
+
+	Timestamp expiration() const { return expiration_; }
+	bool repeat() const { return repeat_; }
+	int64_t sequence() const { return sequence_; }
+
+	//重复定时器到期后，从now开始计算下一次超时时间
+	void restart(Timestamp now);
+
+	//在TimerQueue的最小堆中的下标，由TimerQueue维护
+	size_t heapIndex() const { return heapIndex_; }
+	void setHeapIndex(size_t idx) { heapIndex_ = idx; }
+
+	static int64_t numCreated() { return s_numCreated_; }
+
+	static const size_t kNotInHeap = static_cast<size_t>(-1);
+private:
+	const TimerCallback callback_;
+	Timestamp expiration_;
+	const double interval_;
+	const bool repeat_;
+	const int64_t sequence_;
+	size_t heapIndex_;
+
+	static std::atomic<int64_t> s_numCreated_;
+};
\ No newline at end of file
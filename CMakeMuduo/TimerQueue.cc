@@ -0,0 +1,252 @@
+#include "TimerQueue.h"
+#include "Timer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+static int createTimerfd()
+{
+	int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timerfd < 0)
+	{
+		LOG_FATAL("timerfd_create err:%d\n", errno);
+	}
+	return timerfd;
+}
+
+//计算when距离现在的时间
+static struct timespec howMuchTimeFromNow(Timestamp when)
+{
+	int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+	if (microseconds < 100)
+	{
+		microseconds = 100;
+	}
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+	ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+	return ts;
+}
+
+static void readTimerfd(int timerfd)
+{
+	uint64_t howmany;
+	ssize_t n = ::read(timerfd, &howmany, sizeof howmany);
+	if (n != sizeof howmany)
+	{
+		LOG_ERROR("TimerQueue::handleRead() reads %ld bytes instead of 8\n", n);
+	}
+}
+
+//重新设置timerfd的超时时间为expiration
+static void resetTimerfd(int timerfd, Timestamp expiration)
+{
+	struct itimerspec newValue;
+	struct itimerspec oldValue;
+	memset(&newValue, 0, sizeof newValue);
+	memset(&oldValue, 0, sizeof oldValue);
+	newValue.it_value = howMuchTimeFromNow(expiration);
+	if (::timerfd_settime(timerfd, 0, &newValue, &oldValue) < 0)
+	{
+		LOG_ERROR("timerfd_settime err:%d\n", errno);
+	}
+}
+
+TimerQueue::TimerQueue(EventLoop* loop)
+	:loop_(loop),
+	timerfd_(createTimerfd()),
+	timerfdChannel_(loop, timerfd_)
+{
+	timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+	//定时器回调都在这个channel的读回调中执行
+	timerfdChannel_.setDescriber([]() { return std::string("TimerQueue"); });
+	timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue()
+{
+	timerfdChannel_.disableAll();
+	timerfdChannel_.remove();
+	::close(timerfd_);
+
+	for (const Entry& entry : heap_)
+	{
+		delete entry.timer;
+	}
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
+{
+	Timer* timer = new Timer(std::move(cb), when, interval);
+	loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
+	return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+	loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer* timer)
+{
+	activeTimers_[timer->sequence()] = timer;
+	if (insert(timer))
+	{
+		resetTimerfd(timerfd_, timer->expiration());
+	}
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+	auto it = activeTimers_.find(timerId.sequence_);
+	if (it == activeTimers_.end())
+	{
+		return;	//已经到期或者已经取消
+	}
+	Timer* timer = it->second;
+	activeTimers_.erase(it);
+
+	//在堆中说明还没有到期，直接删除
+	//否则正处于本轮到期的回调中，由reset负责释放
+	if (timer->heapIndex() != Timer::kNotInHeap)
+	{
+		heapRemove(timer->heapIndex());
+		delete timer;
+	}
+}
+
+void TimerQueue::handleRead()
+{
+	Timestamp now(Timestamp::now());
+	readTimerfd(timerfd_);
+
+	expired_.clear();
+	while (!heap_.empty() && heap_[0].when <= now.microSecondsSinceEpoch())
+	{
+		Timer* timer = heap_[0].timer;
+		heapRemove(0);
+		expired_.push_back(timer);
+	}
+
+	for (Timer* timer : expired_)
+	{
+		//前面的回调可能已经取消了后面的定时器
+		if (activeTimers_.count(timer->sequence()))
+		{
+			timer->run();
+		}
+	}
+
+	reset(now);
+}
+
+void TimerQueue::reset(Timestamp now)
+{
+	for (Timer* timer : expired_)
+	{
+		auto it = activeTimers_.find(timer->sequence());
+		if (timer->repeat() && it != activeTimers_.end())
+		{
+			timer->restart(now);
+			insert(timer);
+		}
+		else
+		{
+			if (it != activeTimers_.end())
+			{
+				activeTimers_.erase(it);
+			}
+			delete timer;
+		}
+	}
+	expired_.clear();
+
+	if (!heap_.empty())
+	{
+		resetTimerfd(timerfd_, Timestamp(heap_[0].when));
+	}
+}
+
+bool TimerQueue::insert(Timer* timer)
+{
+	heapPush(timer);
+	return timer->heapIndex() == 0;
+}
+
+void TimerQueue::heapPush(Timer* timer)
+{
+	Entry entry = { timer->expiration().microSecondsSinceEpoch(), timer };
+	heap_.push_back(entry);
+	timer->setHeapIndex(heap_.size() - 1);
+	siftUp(heap_.size() - 1);
+}
+
+void TimerQueue::heapRemove(size_t idx)
+{
+	heap_[idx].timer->setHeapIndex(Timer::kNotInHeap);
+	size_t last = heap_.size() - 1;
+	if (idx != last)
+	{
+		Timer* moved = heap_[last].timer;
+		heapSet(idx, heap_[last]);
+		heap_.pop_back();
+		//被移动过来的元素可能需要上浮也可能需要下沉
+		siftUp(idx);
+		siftDown(moved->heapIndex());
+	}
+	else
+	{
+		heap_.pop_back();
+	}
+}
+
+void TimerQueue::siftUp(size_t idx)
+{
+	Entry entry = heap_[idx];
+	while (idx > 0)
+	{
+		size_t parent = (idx - 1) / 2;
+		if (heap_[parent].when <= entry.when)
+		{
+			break;
+		}
+		heapSet(idx, heap_[parent]);
+		idx = parent;
+	}
+	heapSet(idx, entry);
+}
+
+void TimerQueue::siftDown(size_t idx)
+{
+	Entry entry = heap_[idx];
+	size_t n = heap_.size();
+	while (true)
+	{
+		size_t child = 2 * idx + 1;
+		if (child >= n)
+		{
+			break;
+		}
+		if (child + 1 < n && heap_[child + 1].when < heap_[child].when)
+		{
+			++child;
+		}
+		if (entry.when <= heap_[child].when)
+		{
+			break;
+		}
+		heapSet(idx, heap_[child]);
+		idx = child;
+	}
+	heapSet(idx, entry);
+}
+
+void TimerQueue::heapSet(size_t idx, const Entry& entry)
+{
+	heap_[idx] = entry;
+	entry.timer->setHeapIndex(idx);
+}
\ No newline at end of file
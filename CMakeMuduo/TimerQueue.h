@@ -0,0 +1,65 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+#include "TimerId.h"
+
+#include <vector>
+#include <unordered_map>
+
+class EventLoop;
+class Timer;
+
+//定时器队列 底层是注册在EventLoop上的timerfd
+//所有定时器保存在一个以超时时间为key的最小堆中，插入、到期、取消都是O(logn)
+//堆只会在loop所在线程中被访问，跨线程的添加/取消通过runInLoop转发，不需要加锁
+class TimerQueue :noncopyable
+{
+public:
+	explicit TimerQueue(EventLoop* loop);
+	~TimerQueue();
+
+	//添加一个定时器，线程安全
+	TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+	//取消一个定时器，线程安全
+	void cancel(TimerId timerId);
+
+	size_t size() const { return heap_.size(); }
+private:
+	//堆中的元素，把超时时间放在元素里面，比较时不需要访问Timer对象
+	struct Entry
+	{
+		int64_t when;
+		Timer* timer;
+	};
+	using TimerHeap = std::vector<Entry>;
+	using ActiveTimerMap = std::unordered_map<int64_t, Timer*>;
+
+	void addTimerInLoop(Timer* timer);
+	void cancelInLoop(TimerId timerId);
+	//timerfd可读时的回调
+	void handleRead();
+	//处理完到期定时器后，重新插入重复的定时器
+	void reset(Timestamp now);
+
+	//把timer放入堆中，返回最早超时时间是否发生了变化
+	bool insert(Timer* timer);
+
+	//最小堆的操作，同时维护Timer中记录的堆下标
+	void heapPush(Timer* timer);
+	void heapRemove(size_t idx);
+	void siftUp(size_t idx);
+	void siftDown(size_t idx);
+	void heapSet(size_t idx, const Entry& entry);
+
+	EventLoop* loop_;
+	const int timerfd_;
+	Channel timerfdChannel_;
+
+	TimerHeap heap_;
+	ActiveTimerMap activeTimers_;	//所有没有被取消的定时器 key是定时器序号
+
+	std::vector<Timer*> expired_;	//本轮到期的定时器，复用避免每次分配
+};
\ No newline at end of file
@@ -1,6 +1,13 @@
 #include "Timestamp.h"
 
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
+
+//每个线程缓存上一次格式化的秒数和对应的字符串
+static __thread time_t t_lastSecond = -1;
+//按int的最大宽度留足空间，年份超过4位时只取前19个字符
+static __thread char t_time[64];
 
 Timestamp::Timestamp():microSecondsSinceEpoch_(0){}
 
@@ -9,22 +16,71 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch):microSecondsSinceEpoch_(mic
 
 Timestamp Timestamp::now()
 {
-	time_t ti = time(NULL);
-	return Timestamp(ti);
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
+Timestamp Timestamp::monotonic()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
 }
 
 std::string Timestamp::toString() const
 {
-	char buf[128] = { 0 };
-	tm *tm_time = localtime(&microSecondsSinceEpoch_);
-	snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d", 
-		tm_time->tm_year+1900, 
-		tm_time->tm_mon+1,
-		tm_time->tm_mday,
-		tm_time->tm_hour,
-		tm_time->tm_min,
-		tm_time->tm_sec);
-	return buf;
+	char buf[64];
+	int len = formatTo(buf, sizeof buf, false);
+	return std::string(buf, len);
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
+{
+	char buf[64];
+	int len = formatTo(buf, sizeof buf, showMicroseconds);
+	return std::string(buf, len);
+}
+
+int Timestamp::formatTo(char* buf, size_t len, bool showMicroseconds) const
+{
+	time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+	int microseconds = static_cast<int>(microSecondsSinceEpoch_ % kMicroSecondsPerSecond);
+
+	if (seconds != t_lastSecond)
+	{
+		struct tm tm_time;
+		localtime_r(&seconds, &tm_time);
+		snprintf(t_time, sizeof t_time, "%4d/%02d/%02d %02d:%02d:%02d",
+			tm_time.tm_year+1900,
+			tm_time.tm_mon+1,
+			tm_time.tm_mday,
+			tm_time.tm_hour,
+			tm_time.tm_min,
+			tm_time.tm_sec);
+		t_lastSecond = seconds;
+	}
+
+	//年月日时分秒固定19个字符
+	const size_t kDateLen = 19;
+	if (len <= kDateLen)
+	{
+		return 0;
+	}
+	memcpy(buf, t_time, kDateLen);
+	size_t n = kDateLen;
+	if (showMicroseconds && len > kDateLen + 7)
+	{
+		buf[n++] = '.';
+		for (int i = 5; i >= 0; i--)
+		{
+			buf[n + i] = static_cast<char>('0' + microseconds % 10);
+			microseconds /= 10;
+		}
+		n += 6;
+	}
+	buf[n] = '\0';
+	return static_cast<int>(n);
 }
 
 //#include <iostream>
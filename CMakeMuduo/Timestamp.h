@@ -9,8 +9,48 @@ class Timestamp
 public:
 	Timestamp();
 	explicit Timestamp(int64_t microSecondsSinceEpoch);
+	//CLOCK_REALTIME ΢뾫
 	static Timestamp now();
+	//CLOCK_MONOTONIC ϵͳʱӰ죬ֻʱܺnow()
+	static Timestamp monotonic();
+	static Timestamp invalid() { return Timestamp(); }
+
+	//2024/01/01 12:00:00
 	std::string toString() const;
+	//2024/01/01 12:00:00.123456
+	std::string toFormattedString(bool showMicroseconds = true) const;
+	//ʽbufУڴ棬дĳ
+	//ͬһ߳ʱĲֻᱻ棬仯ʱ¼
+	int formatTo(char* buf, size_t len, bool showMicroseconds = true) const;
+
+	bool valid() const { return microSecondsSinceEpoch_ > 0; }
+	int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+
+	static const int kMicroSecondsPerSecond = 1000 * 1000;
 private:
 	int64_t microSecondsSinceEpoch_;
-};
\ No newline at end of file
+};
+
+inline bool operator<(Timestamp lhs, Timestamp rhs)
+{
+	return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
+
+inline bool operator==(Timestamp lhs, Timestamp rhs)
+{
+	return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+//high - low λ
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+	int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+	return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+//timestampĻseconds
+inline Timestamp addTime(Timestamp timestamp, double seconds)
+{
+	int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+	return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+
+TimingWheel::Entry::Entry()
+	:wheel_(nullptr),
+	expireTick_(0),
+	lastActiveTick_(0),
+	timeoutTicks_(0)
+{
+	prev = next = nullptr;
+}
+
+TimingWheel::Entry::~Entry()
+{
+	if (wheel_)
+	{
+		wheel_->remove(this);
+	}
+}
+
+TimingWheel::TimingWheel(EventLoop* loop, double tickSeconds)
+	:loop_(loop),
+	tickSeconds_(tickSeconds),
+	startMicroSeconds_(0),
+	currentTick_(0),
+	size_(0),
+	started_(false)
+{
+	for (int level = 0; level < kLevels; level++)
+	{
+		for (int i = 0; i < kSlotsPerLevel; i++)
+		{
+			slots_[level][i].prev = slots_[level][i].next = &slots_[level][i];
+		}
+	}
+}
+
+TimingWheel::~TimingWheel()
+{
+	if (started_)
+	{
+		loop_->cancel(timerId_);
+	}
+
+	for (int level = 0; level < kLevels; level++)
+	{
+		for (int i = 0; i < kSlotsPerLevel; i++)
+		{
+			Node* head = &slots_[level][i];
+			while (head->next != head)
+			{
+				Entry* entry = static_cast<Entry*>(head->next);
+				unlink(entry);
+				entry->wheel_ = nullptr;
+			}
+		}
+	}
+}
+
+void TimingWheel::add(Entry* entry, double timeout)
+{
+	if (entry->wheel_)
+	{
+		remove(entry);
+	}
+
+	uint64_t ticks = static_cast<uint64_t>(timeout / tickSeconds_ + 0.5);
+	if (ticks == 0)
+	{
+		ticks = 1;
+	}
+
+	entry->wheel_ = this;
+	entry->timeoutTicks_ = ticks;
+	entry->lastActiveTick_ = currentTick_;
+	entry->expireTick_ = currentTick_ + ticks;
+	place(entry);
+	++size_;
+
+	//第一次有连接加入时才启动定时器
+	if (!started_)
+	{
+		started_ = true;
+		startMicroSeconds_ = Timestamp::monotonic().microSecondsSinceEpoch();
+		timerId_ = loop_->runEvery(tickSeconds_, std::bind(&TimingWheel::onTimer, this));
+	}
+}
+
+void TimingWheel::remove(Entry* entry)
+{
+	if (entry->wheel_ == this)
+	{
+		unlink(entry);
+		entry->wheel_ = nullptr;
+		--size_;
+	}
+}
+
+//用单调时钟计算，系统时间被调整时不会一次推进大量tick，也不会出现负数
+void TimingWheel::onTimer()
+{
+	int64_t elapsed = Timestamp::monotonic().microSecondsSinceEpoch() - startMicroSeconds_;
+	if (elapsed < 0)
+	{
+		return;
+	}
+	uint64_t target = static_cast<uint64_t>(elapsed / (tickSeconds_ * Timestamp::kMicroSecondsPerSecond));
+	while (currentTick_ < target)
+	{
+		tick();
+	}
+}
+
+void TimingWheel::tick()
+{
+	int idx = static_cast<int>(currentTick_ & kSlotMask);
+	//低层转完一圈，把高层对应槽里的entry下放
+	if (idx == 0)
+	{
+		for (int level = 1; level < kLevels; level++)
+		{
+			int slot = static_cast<int>((currentTick_ >> (kLevelBits * level)) & kSlotMask);
+			if (cascade(level, slot) != 0)
+			{
+				break;
+			}
+		}
+	}
+
+	uint64_t now = currentTick_++;
+
+	//先把整个槽摘下来，回调中删除其他entry也是安全的
+	Node pending;
+	Node* head = &slots_[0][idx];
+	if (head->next == head)
+	{
+		return;
+	}
+	pending.next = head->next;
+	pending.prev = head->prev;
+	pending.next->prev = &pending;
+	pending.prev->next = &pending;
+	head->prev = head->next = head;
+
+	while (pending.next != &pending)
+	{
+		Entry* entry = static_cast<Entry*>(pending.next);
+		unlink(entry);
+
+		uint64_t deadline = entry->lastActiveTick_ + entry->timeoutTicks_;
+		if (deadline > now)
+		{
+			//期间有过活动，按最后活跃时间重新放入
+			entry->expireTick_ = deadline;
+			place(entry);
+		}
+		else
+		{
+			entry->wheel_ = nullptr;
+			--size_;
+			if (entry->callback_)
+			{
+				entry->callback_();
+			}
+		}
+	}
+}
+
+void TimingWheel::place(Entry* entry)
+{
+	uint64_t expires = entry->expireTick_;
+	uint64_t delta = expires > currentTick_ ? expires - currentTick_ : 0;
+	if (delta > kMaxTicks)
+	{
+		//超出时间轮的范围，先放到最远的位置，到期后会重新计算
+		delta = kMaxTicks;
+		expires = currentTick_ + delta;
+		entry->expireTick_ = expires;
+	}
+	else if (delta == 0)
+	{
+		expires = currentTick_;
+	}
+
+	int level = 0;
+	while (level < kLevels - 1 && delta >= (1ULL << (kLevelBits * (level + 1))))
+	{
+		level++;
+	}
+	int idx = static_cast<int>((expires >> (kLevelBits * level)) & kSlotMask);
+	link(&slots_[level][idx], entry);
+}
+
+int TimingWheel::cascade(int level, int idx)
+{
+	Node* head = &slots_[level][idx];
+	while (head->next != head)
+	{
+		Entry* entry = static_cast<Entry*>(head->next);
+		unlink(entry);
+		place(entry);
+	}
+	return idx;
+}
+
+void TimingWheel::link(Node* head, Node* node)
+{
+	node->prev = head->prev;
+	node->next = head;
+	head->prev->next = node;
+	head->prev = node;
+}
+
+void TimingWheel::unlink(Node* node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->prev = node->next = nullptr;
+}
\ No newline at end of file
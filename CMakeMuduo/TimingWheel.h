@@ -0,0 +1,97 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TimerId.h"
+
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+class EventLoop;
+
+//分层时间轮 用于大量连接的空闲超时检测
+//每个连接持有一个侵入式的Entry，收到消息时touch只记录最后活跃的tick，是O(1)的一次写操作
+//Entry所在的槽到期时才检查是否真的超时，没超时就按最后活跃时间重新放入时间轮
+//每个tick只处理一个槽，到期的连接成批回调
+//时间轮只能在所属loop的线程中使用
+class TimingWheel :noncopyable
+{
+public:
+	using ExpireCallback = std::function<void()>;
+
+	//双向循环链表的节点，每个槽是一个哨兵节点
+	struct Node
+	{
+		Node* prev;
+		Node* next;
+	};
+
+	class Entry :noncopyable, private Node
+	{
+	public:
+		Entry();
+		~Entry();
+
+		void setExpireCallback(ExpireCallback cb) { callback_ = std::move(cb); }
+		bool linked() const { return wheel_ != nullptr; }
+
+		//记录一次活动，推迟超时
+		void touch()
+		{
+			if (wheel_)
+			{
+				lastActiveTick_ = wheel_->currentTick_;
+			}
+		}
+	private:
+		friend class TimingWheel;
+
+		TimingWheel* wheel_;
+		uint64_t expireTick_;		//所在槽的到期tick
+		uint64_t lastActiveTick_;	//最后一次touch时的tick
+		uint64_t timeoutTicks_;
+		ExpireCallback callback_;
+	};
+
+	explicit TimingWheel(EventLoop* loop, double tickSeconds = 1.0);
+	~TimingWheel();
+
+	//加入时间轮，timeout秒没有touch就回调entry的ExpireCallback
+	void add(Entry* entry, double timeout);
+	void remove(Entry* entry);
+
+	size_t size() const { return size_; }
+	double tickSeconds() const { return tickSeconds_; }
+	uint64_t currentTick() const { return currentTick_; }
+
+	static const int kLevelBits = 6;
+	static const int kLevels = 4;
+	static const int kSlotsPerLevel = 1 << kLevelBits;
+	static const uint64_t kSlotMask = kSlotsPerLevel - 1;
+	static const uint64_t kMaxTicks = (1ULL << (kLevelBits * kLevels)) - 1;
+private:
+	//bench/timingwheel_bench.cc直接推进tick
+	friend struct TimingWheelBench;
+
+	//推进一个tick，处理当前槽中的entry，只由onTimer调用，和流逝的时间保持一致
+	void tick();
+	//按expireTick把entry放到对应层的槽里
+	void place(Entry* entry);
+	//把第level层idx槽中的entry重新分配到低层，返回idx
+	int cascade(int level, int idx);
+	//定时器回调，按实际流逝的时间推进tick
+	void onTimer();
+
+	static void link(Node* head, Node* node);
+	static void unlink(Node* node);
+
+	EventLoop* loop_;
+	const double tickSeconds_;
+	int64_t startMicroSeconds_;	//第0个tick对应的时间 Timestamp::monotonic
+	uint64_t currentTick_;		//下一个要处理的tick
+	size_t size_;
+	bool started_;
+	TimerId timerId_;
+
+	Node slots_[kLevels][kSlotsPerLevel];
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "Tracer.h"
+#include "Logger.h"
+#include "CurrentThread.h"
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+std::atomic<bool> Tracer::s_enabled_(false);
+__thread TraceRing* Tracer::t_ring_ = nullptr;
+
+//所有线程的缓冲区，线程退出后保留，之后还能导出它的记录
+static std::mutex g_mutex;
+static std::vector<TraceRing*> g_rings;
+static size_t g_recordsPerThread = Tracer::kDefaultRecordsPerThread;
+
+//enable时记录一对ticks和CLOCK_MONOTONIC的纳秒，导出时再取一对，用来把ticks换算成时间
+static int64_t g_calibrateTicks = 0;
+static int64_t g_calibrateNanos = 0;
+
+//两次校准之间至少间隔这么久，否则换算的误差太大
+static const int64_t kMinCalibrateNanos = 10 * 1000 * 1000;
+
+static int64_t monotonicNanos()
+{
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+static size_t roundUpPowerOfTwo(size_t n)
+{
+	size_t capacity = 1;
+	while (capacity < n)
+	{
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+void Tracer::enable(size_t recordsPerThread)
+{
+	{
+		std::unique_lock<std::mutex> lock(g_mutex);
+		g_recordsPerThread = roundUpPowerOfTwo(recordsPerThread > 0 ? recordsPerThread : 1);
+		if (g_calibrateNanos == 0)
+		{
+			g_calibrateTicks = ticks();
+			g_calibrateNanos = monotonicNanos();
+		}
+	}
+	s_enabled_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::disable()
+{
+	s_enabled_.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::clear()
+{
+	std::unique_lock<std::mutex> lock(g_mutex);
+	for (TraceRing* ring : g_rings)
+	{
+		ring->base.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}
+
+TraceRing* Tracer::currentRing()
+{
+	TraceRing* ring = new TraceRing;
+	ring->head.store(0, std::memory_order_relaxed);
+	ring->base.store(0, std::memory_order_relaxed);
+	ring->tid = CurrentThread::tid();
+	::memset(ring->threadName, 0, sizeof ring->threadName);
+	::prctl(PR_GET_NAME, ring->threadName);
+	{
+		std::unique_lock<std::mutex> lock(g_mutex);
+		ring->records = new TraceRecord[g_recordsPerThread];
+		ring->mask = g_recordsPerThread - 1;
+		g_rings.push_back(ring);
+	}
+	t_ring_ = ring;
+	return ring;
+}
+
+//把一个缓冲区里还有效的记录拷贝出来
+//拷贝之后再读一次head，拷贝期间可能被覆盖的记录都丢弃
+static void copyRing(const TraceRing* ring, std::vector<TraceRecord>* records)
+{
+	uint64_t capacity = ring->mask + 1;
+	uint64_t head = ring->head.load(std::memory_order_acquire);
+	uint64_t start = std::max(ring->base.load(std::memory_order_relaxed), head > capacity ? head - capacity : 0);
+	records->clear();
+	records->reserve(head - start);
+	for (uint64_t i = start; i < head; i++)
+	{
+		records->push_back(ring->records[i & ring->mask]);
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t after = ring->head.load(std::memory_order_relaxed);
+	//序号为after的记录正在覆盖after-capacity
+	if (after - start >= capacity)
+	{
+		size_t overwritten = static_cast<size_t>(after - capacity + 1 - start);
+		records->erase(records->begin(), records->begin() + std::min(overwritten, records->size()));
+	}
+}
+
+static void appendEscaped(std::string* out, const char* s)
+{
+	for (; *s != '\0'; s++)
+	{
+		if (*s == '"' || *s == '\\')
+		{
+			out->push_back('\\');
+			out->push_back(*s);
+		}
+		else if (static_cast<unsigned char>(*s) >= 0x20)
+		{
+			out->push_back(*s);
+		}
+	}
+}
+
+//一个事件的公共部分 {"name":"...","ph":"X","pid":1,"tid":2,"ts":1.000
+static void appendEventHead(std::string* out, const char* name, const char* phase, int pid, int tid, double micros)
+{
+	char buf[128];
+	out->append(out->back() == '[' ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+	appendEscaped(out, name);
+	snprintf(buf, sizeof buf, "\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", phase, pid, tid, micros);
+	out->append(buf);
+}
+
+//开始和结束配对成'X'事件，开始被覆盖的结束记录丢弃，没有结束的开始原样输出
+std::string Tracer::toChromeTrace()
+{
+	std::vector<TraceRing*> rings;
+	int64_t calibrateTicks = 0;
+	int64_t calibrateNanos = 0;
+	{
+		std::unique_lock<std::mutex> lock(g_mutex);
+		rings = g_rings;
+		calibrateTicks = g_calibrateTicks;
+		calibrateNanos = g_calibrateNanos;
+	}
+
+	double nanosPerTick = 1.0;
+	if (calibrateNanos != 0)
+	{
+		int64_t elapsed = monotonicNanos() - calibrateNanos;
+		if (elapsed < kMinCalibrateNanos)
+		{
+			::usleep(static_cast<useconds_t>((kMinCalibrateNanos - elapsed) / 1000));
+		}
+		int64_t nowTicks = ticks();
+		int64_t nowNanos = monotonicNanos();
+		if (nowTicks > calibrateTicks)
+		{
+			nanosPerTick = static_cast<double>(nowNanos - calibrateNanos) / (nowTicks - calibrateTicks);
+		}
+	}
+	//时间戳是CLOCK_MONOTONIC的微秒
+	auto toMicros = [=](int64_t t) {
+		return (calibrateNanos + (t - calibrateTicks) * nanosPerTick) / 1000.0;
+	};
+
+	int pid = static_cast<int>(::getpid());
+	std::string out("{\"traceEvents\":[");
+	std::vector<TraceRecord> records;
+	std::vector<const TraceRecord*> open;
+	char buf[128];
+	for (const TraceRing* ring : rings)
+	{
+		appendEventHead(&out, "thread_name", "M", pid, ring->tid, 0);
+		out.append(",\"args\":{\"name\":\"");
+		appendEscaped(&out, ring->threadName);
+		out.append("\"}}");
+
+		copyRing(ring, &records);
+		open.clear();
+		for (const TraceRecord& r : records)
+		{
+			if (r.phase == 'B')
+			{
+				open.push_back(&r);
+			}
+			else if (r.phase == 'E')
+			{
+				if (open.empty())
+				{
+					continue;
+				}
+				const TraceRecord* begin = open.back();
+				open.pop_back();
+				double start = toMicros(begin->ticks);
+				appendEventHead(&out, begin->name, "X", pid, ring->tid, start);
+				snprintf(buf, sizeof buf, ",\"dur\":%.3f,\"args\":{\"arg\":%lld,\"result\":%lld}}",
+					toMicros(r.ticks) - start, static_cast<long long>(begin->arg), static_cast<long long>(r.arg));
+				out.append(buf);
+			}
+			else
+			{
+				appendEventHead(&out, r.name, "i", pid, ring->tid, toMicros(r.ticks));
+				snprintf(buf, sizeof buf, ",\"s\":\"t\",\"args\":{\"arg\":%lld}}", static_cast<long long>(r.arg));
+				out.append(buf);
+			}
+		}
+		for (const TraceRecord* begin : open)
+		{
+			appendEventHead(&out, begin->name, "B", pid, ring->tid, toMicros(begin->ticks));
+			snprintf(buf, sizeof buf, ",\"args\":{\"arg\":%lld}}", static_cast<long long>(begin->arg));
+			out.append(buf);
+		}
+	}
+	out.append("\n],\"displayTimeUnit\":\"ns\"}\n");
+	return out;
+}
+
+bool Tracer::writeChromeTrace(const std::string& path)
+{
+	std::string trace = toChromeTrace();
+	FILE* fp = ::fopen(path.c_str(), "we");
+	if (fp == nullptr)
+	{
+		LOG_ERROR("Tracer::writeChromeTrace fopen %s error:%d\n", path.c_str(), errno);
+		return false;
+	}
+	bool ok = ::fwrite(trace.data(), 1, trace.size(), fp) == trace.size();
+	ok = ::fclose(fp) == 0 && ok;
+	if (!ok)
+	{
+		LOG_ERROR("Tracer::writeChromeTrace write %s error:%d\n", path.c_str(), errno);
+	}
+	return ok;
+}
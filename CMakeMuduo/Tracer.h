@@ -0,0 +1,122 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//一条定长的跟踪记录，name必须指向静态存储的字符串，只保存指针
+struct TraceRecord
+{
+	int64_t ticks;		//Tracer::ticks()
+	const char* name;
+	int64_t arg;		//开始记录是参数(一般是fd或者长度)，结束记录是结果
+	char phase;			//'B'开始 'E'结束 'i'瞬时事件
+};
+
+//每个线程一个的环形缓冲区，只有所属线程写，导出时其他线程读
+//写满之后覆盖最老的记录，head_只增不减
+struct TraceRing
+{
+	TraceRecord* records;
+	uint64_t mask;					//容量减一，容量是2的幂
+	std::atomic<uint64_t> head;		//下一条记录的序号
+	std::atomic<uint64_t> base;		//clear时的head，导出时跳过之前的记录
+	pid_t tid;
+	char threadName[16];
+};
+
+//热路径上的低开销跟踪 EventLoop::loop的poll、Channel::handleEvent、TcpConnection的读写等位置记录开始和结束
+//记录写入当前线程的无锁环形缓冲区，不加锁不分配内存，x86上用rdtsc取时间
+//没有打开时每个跟踪点只多一次relaxed读和一个分支
+//toChromeTrace把所有线程的记录导出为Chrome trace的JSON，可以用chrome://tracing或者ui.perfetto.dev打开
+class Tracer :noncopyable
+{
+public:
+	static const size_t kDefaultRecordsPerThread = 64 * 1024;
+
+	//recordsPerThread向上取整到2的幂，只影响之后新建的缓冲区，可以在任意线程调用
+	static void enable(size_t recordsPerThread = kDefaultRecordsPerThread);
+	static void disable();
+	static bool enabled() { return s_enabled_.load(std::memory_order_relaxed); }
+
+	//丢弃已经记录的内容，不影响正在写的线程
+	static void clear();
+
+	//导出时记录可能还在被写，被覆盖的部分会丢弃
+	static std::string toChromeTrace();
+	static bool writeChromeTrace(const std::string& path);
+
+	static int64_t ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return static_cast<int64_t>(__rdtsc());
+#else
+		struct timespec ts;
+		::clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+#endif
+	}
+
+	static void record(char phase, const char* name, int64_t arg)
+	{
+		TraceRing* ring = t_ring_ != nullptr ? t_ring_ : currentRing();
+		uint64_t head = ring->head.load(std::memory_order_relaxed);
+		TraceRecord& r = ring->records[head & ring->mask];
+		r.ticks = ticks();
+		r.name = name;
+		r.arg = arg;
+		r.phase = phase;
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+
+	static void instant(const char* name, int64_t arg = 0)
+	{
+		if (enabled())
+		{
+			record('i', name, arg);
+		}
+	}
+
+private:
+	//第一次记录时创建当前线程的缓冲区
+	static TraceRing* currentRing();
+
+	static std::atomic<bool> s_enabled_;
+	static __thread TraceRing* t_ring_;
+};
+
+//在作用域内记录一对开始和结束，构造时没有打开跟踪就什么都不记录
+class TraceScope :noncopyable
+{
+public:
+	TraceScope(const char* name, int64_t arg = 0)
+		:name_(Tracer::enabled() ? name : nullptr), result_(0)
+	{
+		if (name_ != nullptr)
+		{
+			Tracer::record('B', name_, arg);
+		}
+	}
+
+	~TraceScope()
+	{
+		if (name_ != nullptr)
+		{
+			Tracer::record('E', name_, result_);
+		}
+	}
+
+	//结束记录带上的结果，例如读到的字节数
+	void setResult(int64_t result) { result_ = result; }
+
+private:
+	const char* name_;
+	int64_t result_;
+};
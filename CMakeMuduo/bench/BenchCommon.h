@@ -0,0 +1,405 @@
+#pragma once
+
+//性能测试程序共用的工具 只有头文件，每个测试程序单独编译
+//	BenchArgs: 解析 key=value 形式的命令行参数
+//	BenchReport: 收集每一轮的结果，输出JSON
+//	LatencyHistogram: 对数分桶的延迟直方图，计算p50/p99/p999
+//	drainLoop: 等待loop执行完已经提交的任务，客户端析构之后用
+//	MicroBench: 微基准的运行控制，固定或者自动校准的迭代次数，多轮取中位数，绑核
+
+#include "EventLoop.h"
+#include "CpuAffinity.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <future>
+#include <time.h>
+#include <sys/resource.h>
+
+static inline int64_t nowNanos()
+{
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//同一个进程里既有服务端又有客户端，每个连接要两个fd
+static inline void raiseFdLimit(int64_t needed)
+{
+	struct rlimit rl;
+	if (::getrlimit(RLIMIT_NOFILE, &rl) == 0 && static_cast<int64_t>(rl.rlim_cur) < needed)
+	{
+		rl.rlim_cur = static_cast<int64_t>(rl.rlim_max) < needed ? rl.rlim_max : needed;
+		::setrlimit(RLIMIT_NOFILE, &rl);
+		if (static_cast<int64_t>(rl.rlim_cur) < needed)
+		{
+			fprintf(stderr, "open files limit %ld is less than %ld\n", static_cast<long>(rl.rlim_cur), static_cast<long>(needed));
+		}
+	}
+}
+
+//任务里再提交一次，等前一轮任务中queueInLoop的任务(例如connectDestroyed)也执行完
+static inline void drainLoop(EventLoop* loop)
+{
+	std::promise<void> done;
+	loop->runInLoop([loop, &done]() {
+		loop->queueInLoop([&done]() { done.set_value(); });
+	});
+	done.get_future().wait();
+}
+
+class BenchArgs
+{
+public:
+	BenchArgs(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const char* eq = strchr(argv[i], '=');
+			if (eq == nullptr)
+			{
+				fprintf(stderr, "ignore argument %s, expect key=value\n", argv[i]);
+				continue;
+			}
+			args_[std::string(argv[i], eq - argv[i])] = eq + 1;
+		}
+	}
+
+	std::string getString(const std::string& key, const std::string& def) const
+	{
+		auto it = args_.find(key);
+		return it == args_.end() ? def : it->second;
+	}
+
+	int64_t getInt(const std::string& key, int64_t def) const
+	{
+		auto it = args_.find(key);
+		return it == args_.end() ? def : atoll(it->second.c_str());
+	}
+
+	double getDouble(const std::string& key, double def) const
+	{
+		auto it = args_.find(key);
+		return it == args_.end() ? def : atof(it->second.c_str());
+	}
+
+	//"0,1,2,4"
+	std::vector<int64_t> getIntList(const std::string& key, const std::string& def) const
+	{
+		std::vector<int64_t> values;
+		std::string list = getString(key, def);
+		const char* p = list.c_str();
+		while (*p != '\0')
+		{
+			char* end = nullptr;
+			long long v = strtoll(p, &end, 10);
+			if (end == p)
+			{
+				p++;
+				continue;
+			}
+			values.push_back(v);
+			p = end;
+		}
+		return values;
+	}
+
+	const std::map<std::string, std::string>& all() const { return args_; }
+private:
+	std::map<std::string, std::string> args_;
+};
+
+//{"bench":"pingpong","params":{...},"results":[{...},...]}
+//json=path时写到文件，否则输出到stdout
+class BenchReport
+{
+public:
+	explicit BenchReport(const std::string& name) :name_(name) {}
+
+	void setParam(const std::string& key, const std::string& value) { params_.push_back(std::make_pair(key, quote(value))); }
+	void setParam(const std::string& key, double value) { params_.push_back(std::make_pair(key, number(value))); }
+
+	//开始新的一轮结果
+	void beginResult() { results_.push_back(Fields()); }
+	void add(const std::string& key, double value) { results_.back().push_back(std::make_pair(key, number(value))); }
+	void add(const std::string& key, const std::string& value) { results_.back().push_back(std::make_pair(key, quote(value))); }
+
+	void write(const BenchArgs& args) const
+	{
+		std::string path = args.getString("json", "");
+		FILE* fp = path.empty() ? stdout : fopen(path.c_str(), "w");
+		if (fp == nullptr)
+		{
+			perror(path.c_str());
+			return;
+		}
+		fprintf(fp, "{\"bench\":%s,\"params\":%s,\"results\":[", quote(name_).c_str(), object(params_).c_str());
+		for (size_t i = 0; i < results_.size(); i++)
+		{
+			fprintf(fp, "%s%s", i > 0 ? "," : "", object(results_[i]).c_str());
+		}
+		fprintf(fp, "]}\n");
+		if (fp != stdout)
+		{
+			fclose(fp);
+		}
+	}
+private:
+	using Fields = std::vector<std::pair<std::string, std::string>>;
+
+	static std::string quote(const std::string& s)
+	{
+		std::string result("\"");
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+			}
+			result += c;
+		}
+		result += '"';
+		return result;
+	}
+
+	static std::string number(double v)
+	{
+		char buf[64];
+		snprintf(buf, sizeof buf, "%.17g", v);
+		return buf;
+	}
+
+	static std::string object(const Fields& fields)
+	{
+		std::string result("{");
+		for (size_t i = 0; i < fields.size(); i++)
+		{
+			if (i > 0)
+			{
+				result += ',';
+			}
+			result += quote(fields[i].first) + ':' + fields[i].second;
+		}
+		result += '}';
+		return result;
+	}
+
+	std::string name_;
+	Fields params_;
+	std::vector<Fields> results_;
+};
+
+//每个2的幂区间分成kSubBuckets个桶，相对误差不超过1/kSubBuckets
+//单位由调用者决定，测试程序里都用纳秒
+class LatencyHistogram
+{
+public:
+	LatencyHistogram() :counts_(kBuckets, 0), count_(0), sum_(0), max_(0) {}
+
+	void record(int64_t value)
+	{
+		if (value < 0)
+		{
+			value = 0;
+		}
+		counts_[bucketOf(value)]++;
+		count_++;
+		sum_ += value;
+		if (value > max_)
+		{
+			max_ = value;
+		}
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for (int i = 0; i < kBuckets; i++)
+		{
+			counts_[i] += other.counts_[i];
+		}
+		count_ += other.count_;
+		sum_ += other.sum_;
+		if (other.max_ > max_)
+		{
+			max_ = other.max_;
+		}
+	}
+
+	int64_t count() const { return count_; }
+	int64_t max() const { return max_; }
+	double mean() const { return count_ > 0 ? static_cast<double>(sum_) / count_ : 0; }
+
+	//q在0到1之间，返回所在桶的上界
+	int64_t percentile(double q) const
+	{
+		if (count_ == 0)
+		{
+			return 0;
+		}
+		int64_t target = static_cast<int64_t>(q * count_);
+		if (target >= count_)
+		{
+			target = count_ - 1;
+		}
+		int64_t seen = 0;
+		for (int i = 0; i < kBuckets; i++)
+		{
+			seen += counts_[i];
+			if (seen > target)
+			{
+				int64_t upper = upperBound(i);
+				return upper < max_ ? upper : max_;
+			}
+		}
+		return max_;
+	}
+private:
+	static const int kSubBucketBits = 4;
+	static const int kSubBuckets = 1 << kSubBucketBits;
+	static const int kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+	//小于kSubBuckets的值每个值一个桶，之后每个2的幂区间kSubBuckets个桶
+	static int bucketOf(int64_t value)
+	{
+		uint64_t v = static_cast<uint64_t>(value);
+		if (v < static_cast<uint64_t>(kSubBuckets))
+		{
+			return static_cast<int>(v);
+		}
+		int msb = 63 - __builtin_clzll(v);
+		int shift = msb - kSubBucketBits;
+		int sub = static_cast<int>((v >> shift) & (kSubBuckets - 1));
+		return (shift + 1) * kSubBuckets + sub;
+	}
+
+	static int64_t upperBound(int bucket)
+	{
+		if (bucket < kSubBuckets)
+		{
+			return bucket;
+		}
+		int shift = bucket / kSubBuckets - 1;
+		int sub = bucket % kSubBuckets;
+		return ((static_cast<int64_t>(kSubBuckets + sub + 1)) << shift) - 1;
+	}
+
+	std::vector<int64_t> counts_;
+	int64_t count_;
+	int64_t sum_;
+	int64_t max_;
+};
+
+//防止编译器把被测的计算优化掉
+template<typename T>
+static inline void doNotOptimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//微基准 每个用例跑repeats轮，每轮iters次，报告每次操作的中位数/最小/最大耗时
+//iters=0时先校准，让每一轮至少跑minTime秒，校准的过程同时也是预热
+//cpu>=0时把当前线程绑到这个cpu上(默认0)，cpu=-1不绑定，减少迁移和调度带来的抖动
+//用例间的比较只在同一台机器、同样参数下才有意义
+//通用参数: [iters=0] [repeats=5] [minTime=0.2] [cpu=0] [filter=子串] [json=path]
+class MicroBench
+{
+public:
+	MicroBench(const std::string& name, const BenchArgs& args)
+		:args_(args), report_(name),
+		iterations_(args.getInt("iters", 0)),
+		repeats_(static_cast<int>(args.getInt("repeats", 5))),
+		minTime_(args.getDouble("minTime", 0.2)),
+		cpu_(static_cast<int>(args.getInt("cpu", 0))),
+		filter_(args.getString("filter", ""))
+	{
+		if (repeats_ < 1)
+		{
+			repeats_ = 1;
+		}
+		if (cpu_ >= 0 && !CpuAffinity::pinCurrentThread(cpu_))
+		{
+			fprintf(stderr, "pin to cpu %d failed, run unpinned\n", cpu_);
+			cpu_ = -1;
+		}
+		report_.setParam("iters", static_cast<double>(iterations_));
+		report_.setParam("repeats", repeats_);
+		report_.setParam("minTime", minTime_);
+		report_.setParam("cpu", cpu_);
+	}
+
+	//当前线程绑定的cpu，-1表示没有绑定，测试跨线程的用例可以据此给其他线程选cpu
+	int cpu() const { return cpu_; }
+	const BenchArgs& args() const { return args_; }
+
+	//func(n)执行n次被测操作
+	template<typename Func>
+	void run(const std::string& caseName, Func func)
+	{
+		if (!filter_.empty() && caseName.find(filter_) == std::string::npos)
+		{
+			return;
+		}
+
+		int64_t n = iterations_ > 0 ? iterations_ : calibrate(func);
+		std::vector<double> nsPerOp;
+		for (int i = 0; i < repeats_; i++)
+		{
+			nsPerOp.push_back(static_cast<double>(measure(func, n)) / n);
+		}
+		std::sort(nsPerOp.begin(), nsPerOp.end());
+		double median = nsPerOp[nsPerOp.size() / 2];
+		fprintf(stderr, "%-36s %12.2f ns/op  min %10.2f  max %10.2f  %lld iters\n", caseName.c_str(),
+			median, nsPerOp.front(), nsPerOp.back(), static_cast<long long>(n));
+
+		report_.beginResult();
+		report_.add("case", caseName);
+		report_.add("nsPerOp", median);
+		report_.add("minNsPerOp", nsPerOp.front());
+		report_.add("maxNsPerOp", nsPerOp.back());
+		report_.add("opsPerSec", median > 0 ? 1e9 / median : 0);
+		report_.add("iterations", static_cast<double>(n));
+	}
+
+	void finish() const { report_.write(args_); }
+private:
+	template<typename Func>
+	static int64_t measure(Func& func, int64_t n)
+	{
+		int64_t start = nowNanos();
+		func(n);
+		return nowNanos() - start;
+	}
+
+	template<typename Func>
+	int64_t calibrate(Func& func) const
+	{
+		const int64_t target = static_cast<int64_t>(minTime_ * 1e9);
+		int64_t n = 1;
+		for (;;)
+		{
+			int64_t elapsed = measure(func, n);
+			if (elapsed >= target || n >= (int64_t(1) << 40))
+			{
+				return n;
+			}
+			//按这一次的速度估计，最多放大100倍，避免前几次太快估计不准
+			int64_t next = elapsed > 0 ? static_cast<int64_t>(static_cast<double>(n) * target / elapsed * 1.2) : n * 100;
+			n = std::max(n + 1, std::min(next, n * 100));
+		}
+	}
+
+	BenchArgs args_;
+	BenchReport report_;
+	int64_t iterations_;
+	int repeats_;
+	double minTime_;
+	int cpu_;
+	std::string filter_;
+};
@@ -0,0 +1,151 @@
+//Buffer的微基准
+//  append/retrieve: 小块追加再全部取走，连接上最常见的用法
+//  sliding: 每次追加后只取走大部分，读写位置不断后移，测makeSpace挪动数据的开销
+//  grow: 从空Buffer开始按块追加到目标大小，测扩容的开销，每次操作是一次完整的增长
+//  readFd: socketpair上写入一条消息再用readFd读出来，EAGAIN是没有数据时的读取
+//用法: buffer_bench [通用参数，见BenchCommon.h的MicroBench]
+
+#include "BenchCommon.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+static void appendRetrieve(size_t len, int64_t n)
+{
+	std::string data(len, 'x');
+	Buffer buf;
+	for (int64_t i = 0; i < n; i++)
+	{
+		buf.append(data.data(), data.size());
+		doNotOptimize(buf.peek());
+		buf.retrieveAll();
+	}
+}
+
+static void retrieveAsString(size_t len, int64_t n)
+{
+	std::string data(len, 'x');
+	Buffer buf;
+	for (int64_t i = 0; i < n; i++)
+	{
+		buf.append(data.data(), data.size());
+		std::string s = buf.retrieveAsString(len);
+		doNotOptimize(s.data());
+	}
+}
+
+//一直留着keep字节没有取走
+static void sliding(size_t len, size_t keep, int64_t n)
+{
+	std::string data(len, 'x');
+	Buffer buf;
+	buf.append(data.data(), keep);
+	for (int64_t i = 0; i < n; i++)
+	{
+		buf.append(data.data(), data.size());
+		buf.retrieve(len);
+		doNotOptimize(buf.peek());
+	}
+}
+
+static void grow(size_t chunk, size_t total, int64_t n)
+{
+	std::string data(chunk, 'x');
+	for (int64_t i = 0; i < n; i++)
+	{
+		Buffer buf;
+		for (size_t size = 0; size < total; size += chunk)
+		{
+			buf.append(data.data(), data.size());
+		}
+		doNotOptimize(buf.peek());
+	}
+}
+
+static void readFd(int fds[2], size_t len, int64_t n)
+{
+	std::string data(len, 'x');
+	Buffer buf;
+	int savedErrno = 0;
+	for (int64_t i = 0; i < n; i++)
+	{
+		size_t written = 0;
+		while (written < len)
+		{
+			ssize_t w = ::write(fds[1], data.data() + written, len - written);
+			if (w <= 0)
+			{
+				perror("write");
+				return;
+			}
+			written += w;
+		}
+		while (buf.readableBytes() < len)
+		{
+			if (buf.readFd(fds[0], &savedErrno) <= 0)
+			{
+				perror("readFd");
+				return;
+			}
+		}
+		buf.retrieveAll();
+	}
+}
+
+static void readFdEmpty(int fds[2], int64_t n)
+{
+	Buffer buf;
+	int savedErrno = 0;
+	for (int64_t i = 0; i < n; i++)
+	{
+		doNotOptimize(buf.readFd(fds[0], &savedErrno));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	MicroBench bench("buffer", args);
+
+	const size_t sizes[] = { 64, 1024, 16 * 1024 };
+	char name[64];
+	for (size_t len : sizes)
+	{
+		snprintf(name, sizeof name, "append/retrieveAll %zu", len);
+		bench.run(name, [len](int64_t n) { appendRetrieve(len, n); });
+	}
+	bench.run("append/retrieveAsString 64", [](int64_t n) { retrieveAsString(64, n); });
+	bench.run("sliding 512 keep 100", [](int64_t n) { sliding(512, 100, n); });
+	bench.run("sliding 4096 keep 1000", [](int64_t n) { sliding(4096, 1000, n); });
+	bench.run("grow 4096 to 64k", [](int64_t n) { grow(4096, 64 * 1024, n); });
+	bench.run("grow 4096 to 1m", [](int64_t n) { grow(4096, 1024 * 1024, n); });
+	bench.run("grow 64 to 64k", [](int64_t n) { grow(64, 64 * 1024, n); });
+
+	int fds[2];
+	if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+	{
+		perror("socketpair");
+		return 1;
+	}
+	int bufSize = 1024 * 1024;
+	::setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof bufSize);
+	::setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof bufSize);
+	::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+	const size_t readSizes[] = { 64, 4096, 65536 };
+	for (size_t len : readSizes)
+	{
+		snprintf(name, sizeof name, "readFd socketpair %zu", len);
+		bench.run(name, [&fds, len](int64_t n) { readFd(fds, len, n); });
+	}
+	bench.run("readFd EAGAIN", [&fds](int64_t n) { readFdEmpty(fds, n); });
+	::close(fds[0]);
+	::close(fds[1]);
+
+	bench.finish();
+	return 0;
+}
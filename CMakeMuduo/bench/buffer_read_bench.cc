@@ -0,0 +1,96 @@
+//Buffer::readFd小消息的读取开销测试
+//用socketpair每次写入一条小消息再读出来，对比：
+//  old: 原来的实现，每次在栈上清零64k的extrabuf
+//  new: 线程局部的extrabuf加上自适应的预留空间
+//用法: buffer_read_bench [消息长度] [次数]
+
+#include "Buffer.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+//原来的Buffer::readFd
+static ssize_t oldReadFd(Buffer* buf, int fd, int* savedErrno)
+{
+	char extrabuf[65536] = { 0 };
+	struct iovec vec[2];
+	const size_t writable = buf->writableBytes();
+	vec[0].iov_base = buf->beginWrite();
+	vec[0].iov_len = writable;
+	vec[1].iov_base = extrabuf;
+	vec[1].iov_len = sizeof extrabuf;
+
+	const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+	const ssize_t n = ::readv(fd, vec, iovcnt);
+	if (n < 0)
+	{
+		*savedErrno = errno;
+	}
+	else if (static_cast<size_t>(n) <= writable)
+	{
+		buf->hasWritten(n);
+	}
+	else
+	{
+		buf->hasWritten(writable);
+		buf->append(extrabuf, n - writable);
+	}
+	return n;
+}
+
+template<typename Func>
+static void run(const char* name, int fds[2], const char* msg, size_t len, long iterations, Func readFunc)
+{
+	Buffer buf;
+	int savedErrno = 0;
+	int64_t bytes = 0;
+	Timestamp start(Timestamp::now());
+	for (long i = 0; i < iterations; i++)
+	{
+		if (::write(fds[1], msg, len) != static_cast<ssize_t>(len))
+		{
+			perror("write");
+			exit(1);
+		}
+		ssize_t n = readFunc(&buf, fds[0], &savedErrno);
+		if (n > 0)
+		{
+			bytes += n;
+		}
+		buf.retrieveAll();
+	}
+	double seconds = timeDifference(Timestamp::now(), start);
+	printf("%-4s %8.1f ns/read %8.2f MB/s\n", name, seconds * 1e9 / iterations, bytes / seconds / 1024 / 1024);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t msgLen = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 20;
+	const long iterations = argc > 2 ? atol(argv[2]) : 1000000;
+
+	int fds[2];
+	if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+	{
+		perror("socketpair");
+		return 1;
+	}
+	char* msg = static_cast<char*>(malloc(msgLen));
+	memset(msg, 'x', msgLen);
+
+	printf("message=%zu bytes iterations=%ld\n", msgLen, iterations);
+	run("old", fds, msg, msgLen, iterations, oldReadFd);
+	run("new", fds, msg, msgLen, iterations, [](Buffer* buf, int fd, int* savedErrno) {
+		return buf->readFd(fd, savedErrno);
+	});
+
+	free(msg);
+	::close(fds[0]);
+	::close(fds[1]);
+	return 0;
+}
@@ -0,0 +1,137 @@
+//建立/关闭连接的速度测试 服务端和客户端在同一个进程里，通过loopback通信
+//服务端每接受一个连接就马上shutdown，客户端收到FIN后关闭，然后立刻重连(enableRetry)
+//conns个客户端同时在做这件事，统计seconds秒内服务端接受的连接数，主要测Acceptor和连接建立、销毁的路径
+//reuseport=1时使用TcpServer::kReusePortPerLoop，每个subloop自己accept
+//用法: churn_bench [conns=16] [seconds=3] [threads=0,1,2,4] [clientThreads=1] [reuseport=0] [port=9950] [json=path]
+
+#include "BenchCommon.h"
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+struct RunResult
+{
+	double seconds;
+	int64_t accepted;
+};
+
+static void onServerConnection(std::atomic<int64_t>* accepted, const TcpConnectionPtr& conn)
+{
+	if (conn->connected())
+	{
+		accepted->fetch_add(1, std::memory_order_relaxed);
+		conn->shutdown();
+	}
+}
+
+static void discard(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+	buf->retrieveAll();
+}
+
+static void ignoreConnection(const TcpConnectionPtr&)
+{
+}
+
+static RunResult runOnce(uint16_t port, int numConns, double seconds, int numThreads, int clientThreads, bool reusePort)
+{
+	EventLoop loop;
+	InetAddress serverAddr(port);
+	std::atomic<int64_t> accepted(0);
+	TcpServer server(&loop, serverAddr, "churn-server",
+		reusePort ? TcpServer::kReusePortPerLoop : TcpServer::kNoReusePort);
+	server.setThreadNum(numThreads);
+	server.setConnectionCallback(std::bind(onServerConnection, &accepted, std::placeholders::_1));
+	server.setMessageCallback(discard);
+	server.start();
+
+	EventLoopThreadPool clientPool(&loop, "churn-client");
+	clientPool.setThreadNum(clientThreads);
+	clientPool.start();
+	std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+
+	std::vector<std::unique_ptr<TcpClient>> clients;
+	for (int i = 0; i < numConns; i++)
+	{
+		TcpClient* client = new TcpClient(clientLoops[i % clientLoops.size()], serverAddr, "churn-client");
+		clients.emplace_back(client);
+		client->setConnectionCallback(ignoreConnection);
+		client->setMessageCallback(discard);
+		client->enableRetry();
+		client->connect();
+	}
+
+	//预热0.2秒之后开始计数
+	RunResult result = { 0, 0 };
+	int64_t startNanos = 0;
+	int64_t startAccepted = 0;
+	loop.runAfter(0.2, [&]() {
+		startNanos = nowNanos();
+		startAccepted = accepted.load();
+		loop.runAfter(seconds, [&]() {
+			result.accepted = accepted.load() - startAccepted;
+			result.seconds = static_cast<double>(nowNanos() - startNanos) / 1e9;
+			loop.quit();
+		});
+	});
+	loop.loop();
+
+	//先停止重连，再销毁客户端
+	for (auto& client : clients)
+	{
+		client->stop();
+	}
+	for (EventLoop* ioLoop : clientLoops)
+	{
+		drainLoop(ioLoop);
+	}
+	clients.clear();
+	for (EventLoop* ioLoop : clientLoops)
+	{
+		drainLoop(ioLoop);
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	const int numConns = static_cast<int>(args.getInt("conns", 16));
+	const double seconds = args.getDouble("seconds", 3.0);
+	const std::vector<int64_t> threads = args.getIntList("threads", "0,1,2,4");
+	const int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+	const bool reusePort = args.getInt("reuseport", 0) != 0;
+	uint16_t port = static_cast<uint16_t>(args.getInt("port", 9950));
+
+	Logger::setLogLevel(ERROR);
+	raiseFdLimit(2 * numConns + 256);
+
+	BenchReport report("churn");
+	report.setParam("conns", numConns);
+	report.setParam("seconds", seconds);
+	report.setParam("clientThreads", clientThreads);
+	report.setParam("reuseport", reusePort ? 1 : 0);
+
+	for (int64_t numThreads : threads)
+	{
+		RunResult result = runOnce(port++, numConns, seconds, static_cast<int>(numThreads),
+			clientThreads > 0 ? clientThreads : 1, reusePort);
+		double elapsed = result.seconds > 0 ? result.seconds : 1;
+		fprintf(stderr, "threads=%-3ld %10.0f conn/s\n", static_cast<long>(numThreads), result.accepted / elapsed);
+
+		report.beginResult();
+		report.add("threads", static_cast<double>(numThreads));
+		report.add("seconds", result.seconds);
+		report.add("accepted", static_cast<double>(result.accepted));
+		report.add("connPerSec", result.accepted / elapsed);
+	}
+	report.write(args);
+	return 0;
+}
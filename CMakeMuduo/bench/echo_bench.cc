@@ -0,0 +1,112 @@
+//同一个echo负载下水平触发和边沿触发的对比
+//每个客户端线程一个连接，发送一条消息，收到完整的回显之后再发下一条
+//用法: echo_bench [连接数] [消息长度] [秒数] [IO线程数]
+//设置环境变量MUDUO_USE_POLL可以对比poll和epoll
+
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+static void runClient(uint16_t port, size_t msgLen, std::atomic<bool>* stop, std::atomic<int64_t>* messages)
+{
+	int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+	InetAddress addr(port);
+	if (::connect(sockfd, (sockaddr*)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+	{
+		perror("connect");
+		exit(1);
+	}
+	int on = 1;
+	::setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+
+	std::string message(msgLen, 'x');
+	std::vector<char> reply(msgLen);
+	int64_t count = 0;
+	while (!stop->load(std::memory_order_relaxed))
+	{
+		size_t sent = 0;
+		while (sent < msgLen)
+		{
+			ssize_t n = ::write(sockfd, message.data() + sent, msgLen - sent);
+			if (n <= 0)
+			{
+				goto done;
+			}
+			sent += n;
+		}
+		size_t received = 0;
+		while (received < msgLen)
+		{
+			ssize_t n = ::read(sockfd, reply.data() + received, msgLen - received);
+			if (n <= 0)
+			{
+				goto done;
+			}
+			received += n;
+		}
+		count++;
+	}
+done:
+	messages->fetch_add(count);
+	::close(sockfd);
+}
+
+static void runMode(bool edgeTriggered, uint16_t port, int numConns, size_t msgLen, double seconds, int numThreads)
+{
+	EventLoop loop;
+	InetAddress listenAddr(port);
+	TcpServer server(&loop, listenAddr, edgeTriggered ? "echo-et" : "echo-lt");
+	server.setThreadNum(numThreads);
+	server.setEdgeTriggered(edgeTriggered);
+	server.setConnectionCallback([](const TcpConnectionPtr&) {});
+	server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+		conn->send(buf);
+	});
+	server.start();
+
+	std::atomic<bool> stop(false);
+	std::atomic<int64_t> messages(0);
+	std::vector<std::thread> clients;
+	loop.runAfter(0.1, [&]() {
+		for (int i = 0; i < numConns; i++)
+		{
+			clients.push_back(std::thread(runClient, port, msgLen, &stop, &messages));
+		}
+	});
+	loop.runAfter(0.1 + seconds, [&]() { stop = true; });
+	loop.runAfter(0.6 + seconds, [&]() { loop.quit(); });
+	loop.loop();
+	for (std::thread& t : clients)
+	{
+		t.join();
+	}
+
+	double total = static_cast<double>(messages.load());
+	printf("%s  %10.0f msg/s %10.2f MB/s\n", edgeTriggered ? "ET" : "LT",
+		total / seconds, total * msgLen / seconds / 1024 / 1024);
+}
+
+int main(int argc, char* argv[])
+{
+	const int numConns = argc > 1 ? atoi(argv[1]) : 16;
+	const size_t msgLen = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 64;
+	const double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+	const int numThreads = argc > 4 ? atoi(argv[4]) : 0;
+
+	Logger::setLogLevel(ERROR);
+	printf("conns=%d message=%zu bytes seconds=%.1f io threads=%d\n", numConns, msgLen, seconds, numThreads);
+	runMode(false, 9901, numConns, msgLen, seconds, numThreads);
+	runMode(true, 9902, numConns, msgLen, seconds, numThreads);
+	return 0;
+}
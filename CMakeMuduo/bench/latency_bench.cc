@@ -0,0 +1,214 @@
+//请求/响应延迟测试 服务端和客户端在同一个进程里，通过loopback通信
+//每个连接同时只有一个请求，收到完整的size字节响应之后记录延迟，马上发下一个请求(闭环)
+//延迟记录在每个客户端loop自己的直方图里，结束后合并，输出p50/p99/p999
+//用法: latency_bench [conns=16] [size=64] [seconds=3] [threads=0,1,2,4] [clientThreads=1] [et=0] [port=9930] [json=path]
+
+#include "BenchCommon.h"
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <future>
+
+//一个客户端连接 只在它的loop中访问
+struct Session
+{
+	std::unique_ptr<TcpClient> client;
+	LatencyHistogram* histogram;	//所在loop的直方图
+	int64_t sentNanos;
+};
+
+struct RunResult
+{
+	int connected;
+	double seconds;
+	LatencyHistogram histogram;
+};
+
+static void onServerConnection(const TcpConnectionPtr& conn)
+{
+	if (conn->connected())
+	{
+		conn->setTcpNoDelay(true);
+	}
+}
+
+static void echo(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+	conn->send(buf);
+}
+
+static void onClientConnection(Session* session, const std::string* request, std::atomic<int>* connected,
+	const TcpConnectionPtr& conn)
+{
+	if (conn->connected())
+	{
+		conn->setTcpNoDelay(true);
+		connected->fetch_add(1, std::memory_order_relaxed);
+		session->sentNanos = nowNanos();
+		conn->send(*request);
+	}
+}
+
+static void onClientMessage(Session* session, const std::string* request, const std::atomic<bool>* recording,
+	const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+	size_t size = request->size();
+	if (buf->readableBytes() < size)
+	{
+		return;
+	}
+	int64_t now = nowNanos();
+	if (recording->load(std::memory_order_relaxed))
+	{
+		session->histogram->record(now - session->sentNanos);
+	}
+	buf->retrieve(size);
+	session->sentNanos = now;
+	conn->send(*request);
+}
+
+static void collectHistogram(const LatencyHistogram* from, LatencyHistogram* to, std::promise<void>* done)
+{
+	to->merge(*from);
+	done->set_value();
+}
+
+static RunResult runOnce(uint16_t port, int numConns, size_t msgLen, double seconds, int numThreads,
+	int clientThreads, bool edgeTriggered)
+{
+	Logger::setLogLevel(ERROR);
+	EventLoop loop;
+	InetAddress serverAddr(port);
+	TcpServer server(&loop, serverAddr, "latency-server");
+	server.setThreadNum(numThreads);
+	server.setEdgeTriggered(edgeTriggered);
+	server.setConnectionCallback(onServerConnection);
+	server.setMessageCallback(echo);
+	server.start();
+
+	EventLoopThreadPool clientPool(&loop, "latency-client");
+	clientPool.setThreadNum(clientThreads);
+	clientPool.start();
+	std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+	std::vector<LatencyHistogram> histograms(clientLoops.size());
+
+	const std::string request(msgLen, 'x');
+	std::atomic<int> connected(0);
+	std::atomic<bool> recording(false);
+	std::vector<std::unique_ptr<Session>> sessions;
+	for (int i = 0; i < numConns; i++)
+	{
+		size_t index = i % clientLoops.size();
+		Session* session = new Session;
+		sessions.emplace_back(session);
+		session->histogram = &histograms[index];
+		session->sentNanos = 0;
+		session->client.reset(new TcpClient(clientLoops[index], serverAddr, "latency-client"));
+		session->client->setEdgeTriggered(edgeTriggered);
+		session->client->setConnectionCallback(std::bind(onClientConnection, session, &request, &connected,
+			std::placeholders::_1));
+		session->client->setMessageCallback(std::bind(onClientMessage, session, &request, &recording,
+			std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+		session->client->connect();
+	}
+
+	//所有连接都建立之后再预热0.2秒才开始记录，最多等10秒
+	RunResult result;
+	result.connected = 0;
+	result.seconds = 0;
+	int64_t startNanos = 0;
+	const int64_t deadline = nowNanos() + 10 * 1000000000LL;
+	std::function<void()> waitConnected;
+	waitConnected = [&]() {
+		if (connected.load() < numConns && nowNanos() < deadline)
+		{
+			loop.runAfter(0.01, waitConnected);
+			return;
+		}
+		result.connected = connected.load();
+		loop.runAfter(0.2, [&]() {
+			startNanos = nowNanos();
+			recording = true;
+			loop.runAfter(seconds, [&]() {
+				recording = false;
+				result.seconds = static_cast<double>(nowNanos() - startNanos) / 1e9;
+				loop.quit();
+			});
+		});
+	};
+	loop.runAfter(0.01, waitConnected);
+	loop.loop();
+
+	//直方图只在各自的loop中修改，到loop中合并
+	for (size_t i = 0; i < clientLoops.size(); i++)
+	{
+		std::promise<void> done;
+		clientLoops[i]->runInLoop(std::bind(collectHistogram, &histograms[i], &result.histogram, &done));
+		done.get_future().wait();
+	}
+
+	//客户端的连接在各自的loop中强制关闭，等关闭完成之后再停止线程
+	//连接上还有数据在传输，服务端会读到RST，之后的错误日志不用输出，下一轮开始时再打开
+	Logger::setLogLevel(FATAL);
+	sessions.clear();
+	for (EventLoop* ioLoop : clientLoops)
+	{
+		drainLoop(ioLoop);
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	const int numConns = static_cast<int>(args.getInt("conns", 16));
+	const int64_t size = args.getInt("size", 64);
+	const double seconds = args.getDouble("seconds", 3.0);
+	const std::vector<int64_t> threads = args.getIntList("threads", "0,1,2,4");
+	const int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+	const bool edgeTriggered = args.getInt("et", 0) != 0;
+	uint16_t port = static_cast<uint16_t>(args.getInt("port", 9930));
+
+	raiseFdLimit(2 * numConns + 256);
+
+	BenchReport report("latency");
+	report.setParam("conns", numConns);
+	report.setParam("size", static_cast<double>(size));
+	report.setParam("seconds", seconds);
+	report.setParam("clientThreads", clientThreads);
+	report.setParam("et", edgeTriggered ? 1 : 0);
+
+	for (int64_t numThreads : threads)
+	{
+		RunResult result = runOnce(port++, numConns, static_cast<size_t>(size > 0 ? size : 1), seconds,
+			static_cast<int>(numThreads), clientThreads > 0 ? clientThreads : 1, edgeTriggered);
+		const LatencyHistogram& h = result.histogram;
+		double elapsed = result.seconds > 0 ? result.seconds : 1;
+		//直方图单位是纳秒，输出微秒
+		fprintf(stderr, "threads=%-3ld connected=%-6d %10.0f req/s  mean=%.1fus p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus\n",
+			static_cast<long>(numThreads), result.connected, h.count() / elapsed, h.mean() / 1000,
+			h.percentile(0.5) / 1000.0, h.percentile(0.99) / 1000.0, h.percentile(0.999) / 1000.0, h.max() / 1000.0);
+
+		report.beginResult();
+		report.add("threads", static_cast<double>(numThreads));
+		report.add("connected", result.connected);
+		report.add("seconds", result.seconds);
+		report.add("requests", static_cast<double>(h.count()));
+		report.add("reqPerSec", h.count() / elapsed);
+		report.add("meanUs", h.mean() / 1000);
+		report.add("p50Us", h.percentile(0.5) / 1000.0);
+		report.add("p99Us", h.percentile(0.99) / 1000.0);
+		report.add("p999Us", h.percentile(0.999) / 1000.0);
+		report.add("maxUs", h.max() / 1000.0);
+	}
+	report.write(args);
+	return 0;
+}
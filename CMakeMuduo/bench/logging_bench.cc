@@ -0,0 +1,77 @@
+//日志宏的开销测试
+//被关闭的日志语句只剩一次级别读取和一个分支，和空循环的差距应该在1ns以内
+//打开的日志输出到一个只计数的函数，只测格式化的开销
+//用法: logging_bench [通用参数，见BenchCommon.h的MicroBench]
+
+#include "BenchCommon.h"
+#include "Logger.h"
+
+#include <stdio.h>
+
+static int64_t g_bytes = 0;
+
+static void nullOutput(const char*, int len)
+{
+	g_bytes += len;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	MicroBench bench("logging", args);
+	Logger::setOutput(nullOutput);
+
+	bench.run("empty loop", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(i);
+		}
+	});
+
+	Logger::setLogLevel(ERROR);
+	bench.run("LOG_INFO disabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(i);
+			LOG_INFO("fd=%d bytes=%ld\n", 5, static_cast<long>(i));
+		}
+	});
+	bench.run("LOG_STREAM(INFO) disabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(i);
+			LOG_STREAM(INFO) << "fd=" << 5 << " bytes=" << i;
+		}
+	});
+	bench.run("LOG_DEBUG compiled out", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(i);
+			LOG_DEBUG("fd=%d bytes=%ld\n", 5, static_cast<long>(i));
+		}
+	});
+
+	Logger::setLogLevel(INFO);
+	bench.run("LOG_INFO enabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			LOG_INFO("fd=%d bytes=%ld\n", 5, static_cast<long>(i));
+		}
+	});
+	bench.run("LOG_STREAM(INFO) enabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			LOG_STREAM(INFO) << "fd=" << 5 << " bytes=" << i;
+		}
+	});
+	bench.run("LOG_ERROR enabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			LOG_ERROR("fd=%d bytes=%ld\n", 5, static_cast<long>(i));
+		}
+	});
+
+	fprintf(stderr, "%lld bytes formatted\n", static_cast<long long>(g_bytes));
+	bench.finish();
+	return 0;
+}
@@ -0,0 +1,100 @@
+//EventLoop任务队列的微基准
+//  runInLoop same thread: 在loop线程中调用，直接执行
+//  queueInLoop same thread: 在loop线程中投递一批任务，再由loop执行，包括一次poll和唤醒
+//  queueInLoop cross thread: 另一个线程连续投递，统计loop执行完所有任务的吞吐
+//  runInLoop ping-pong: 两个loop互相投递，每次操作是一次往返，包括两次唤醒
+//loop线程绑定在cpu之后的cpu上(按cpu个数取模)，cpu=-1时都不绑定
+//用法: loop_bench [通用参数，见BenchCommon.h的MicroBench]
+
+#include "BenchCommon.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <future>
+#include <unistd.h>
+
+static int64_t g_counter = 0;
+
+static void increment()
+{
+	g_counter++;
+}
+
+static void sameThreadRun(EventLoop* loop, int64_t n)
+{
+	for (int64_t i = 0; i < n; i++)
+	{
+		loop->runInLoop(increment);
+	}
+	doNotOptimize(g_counter);
+}
+
+static void sameThreadQueue(EventLoop* loop, int64_t n)
+{
+	for (int64_t i = 0; i < n; i++)
+	{
+		loop->queueInLoop(increment);
+	}
+	loop->queueInLoop([loop]() { loop->quit(); });
+	//在loop线程中投递不会唤醒loop，自己唤醒一次，否则poll要等到超时
+	loop->wakeup();
+	loop->loop();
+}
+
+static void crossThreadQueue(EventLoop* loop, int64_t n)
+{
+	std::promise<void> done;
+	for (int64_t i = 0; i < n; i++)
+	{
+		loop->queueInLoop(increment);
+	}
+	loop->queueInLoop([&done]() { done.set_value(); });
+	done.get_future().wait();
+}
+
+//在from中执行，把剩下的往返交给to
+static void bounce(EventLoop* from, EventLoop* to, int64_t remaining, std::promise<void>* done)
+{
+	if (remaining == 0)
+	{
+		done->set_value();
+		return;
+	}
+	to->queueInLoop(std::bind(bounce, to, from, remaining - 1, done));
+}
+
+static void pingPong(EventLoop* a, EventLoop* b, int64_t n)
+{
+	std::promise<void> done;
+	//一次往返是两次投递
+	a->runInLoop(std::bind(bounce, a, b, 2 * n, &done));
+	done.get_future().wait();
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	MicroBench bench("loop", args);
+	Logger::setLogLevel(ERROR);
+
+	//main线程的loop，测在loop线程中调用的情况
+	EventLoop loop;
+	bench.run("runInLoop same thread", [&loop](int64_t n) { sameThreadRun(&loop, n); });
+	bench.run("queueInLoop same thread", [&loop](int64_t n) { sameThreadQueue(&loop, n); });
+
+	long numCpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+	int cpuA = bench.cpu() >= 0 && numCpus > 1 ? static_cast<int>((bench.cpu() + 1) % numCpus) : -1;
+	int cpuB = bench.cpu() >= 0 && numCpus > 2 ? static_cast<int>((bench.cpu() + 2) % numCpus) : cpuA;
+	EventLoopThread threadA(EventLoopThread::ThreadInitCallback(), "bench-a", cpuA);
+	EventLoopThread threadB(EventLoopThread::ThreadInitCallback(), "bench-b", cpuB);
+	EventLoop* a = threadA.startLoop();
+	EventLoop* b = threadB.startLoop();
+
+	bench.run("queueInLoop cross thread", [a](int64_t n) { crossThreadQueue(a, n); });
+	bench.run("runInLoop ping-pong round trip", [a, b](int64_t n) { pingPong(a, b, n); });
+
+	bench.finish();
+	return 0;
+}
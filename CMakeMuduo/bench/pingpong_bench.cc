@@ -0,0 +1,170 @@
+//ping-pong吞吐测试 服务端和客户端在同一个进程里，通过loopback通信
+//每个连接建立后客户端发出一条size字节的消息，之后双方收到什么就发回什么，统计所有连接都建立之后seconds秒内收到的字节数
+//客户端是跑在clientThreads个loop上的TcpClient，可以到上万个连接
+//sizes和threads可以是逗号分隔的列表，每个组合跑一轮，threads是TcpServer::setThreadNum的参数
+//用法: pingpong_bench [conns=100] [sizes=64,4096] [seconds=3] [threads=0,1,2,4] [clientThreads=1] [et=0] [port=9910] [json=path]
+
+#include "BenchCommon.h"
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+struct RunResult
+{
+	int connected;
+	double seconds;
+	int64_t bytes;
+};
+
+static void onServerConnection(const TcpConnectionPtr& conn)
+{
+	if (conn->connected())
+	{
+		conn->setTcpNoDelay(true);
+	}
+}
+
+static void echo(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+	conn->send(buf);
+}
+
+static void onClientConnection(const std::string* message, std::atomic<int>* connected, const TcpConnectionPtr& conn)
+{
+	if (conn->connected())
+	{
+		conn->setTcpNoDelay(true);
+		conn->send(*message);
+		connected->fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+static void onClientMessage(std::atomic<int64_t>* bytes, const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+	bytes->fetch_add(static_cast<int64_t>(buf->readableBytes()), std::memory_order_relaxed);
+	conn->send(buf);
+}
+
+static RunResult runOnce(uint16_t port, int numConns, size_t msgLen, double seconds, int numThreads,
+	int clientThreads, bool edgeTriggered)
+{
+	Logger::setLogLevel(ERROR);
+	EventLoop loop;
+	InetAddress serverAddr(port);
+	TcpServer server(&loop, serverAddr, "pingpong-server");
+	server.setThreadNum(numThreads);
+	server.setEdgeTriggered(edgeTriggered);
+	server.setConnectionCallback(onServerConnection);
+	server.setMessageCallback(echo);
+	server.start();
+
+	//客户端用单独的线程，不和服务端共用loop
+	EventLoopThreadPool clientPool(&loop, "pingpong-client");
+	clientPool.setThreadNum(clientThreads);
+	clientPool.start();
+	std::vector<EventLoop*> clientLoops = clientPool.getAllLoops();
+
+	const std::string message(msgLen, 'x');
+	std::atomic<int> connected(0);
+	std::atomic<int64_t> bytes(0);
+	std::vector<std::unique_ptr<TcpClient>> clients;
+	for (int i = 0; i < numConns; i++)
+	{
+		EventLoop* ioLoop = clientLoops[i % clientLoops.size()];
+		TcpClient* client = new TcpClient(ioLoop, serverAddr, "pingpong-client");
+		clients.emplace_back(client);
+		client->setEdgeTriggered(edgeTriggered);
+		client->setConnectionCallback(std::bind(onClientConnection, &message, &connected, std::placeholders::_1));
+		client->setMessageCallback(std::bind(onClientMessage, &bytes, std::placeholders::_1,
+			std::placeholders::_2, std::placeholders::_3));
+		client->connect();
+	}
+
+	//所有连接都建立之后才开始计时，最多等10秒
+	RunResult result = { 0, 0, 0 };
+	int64_t startNanos = 0;
+	int64_t startBytes = 0;
+	const int64_t deadline = nowNanos() + 10 * 1000000000LL;
+	std::function<void()> waitConnected;
+	waitConnected = [&]() {
+		if (connected.load() < numConns && nowNanos() < deadline)
+		{
+			loop.runAfter(0.01, waitConnected);
+			return;
+		}
+		result.connected = connected.load();
+		startNanos = nowNanos();
+		startBytes = bytes.load();
+		loop.runAfter(seconds, [&]() {
+			result.bytes = bytes.load() - startBytes;
+			result.seconds = static_cast<double>(nowNanos() - startNanos) / 1e9;
+			loop.quit();
+		});
+	};
+	loop.runAfter(0.01, waitConnected);
+	loop.loop();
+
+	//客户端的连接在各自的loop中强制关闭，等关闭完成之后再停止线程
+	//连接上还有数据在传输，服务端会读到RST，之后的错误日志不用输出，下一轮开始时再打开
+	Logger::setLogLevel(FATAL);
+	clients.clear();
+	for (EventLoop* ioLoop : clientLoops)
+	{
+		drainLoop(ioLoop);
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	const int numConns = static_cast<int>(args.getInt("conns", 100));
+	const std::vector<int64_t> sizes = args.getIntList("sizes", "64,4096");
+	const double seconds = args.getDouble("seconds", 3.0);
+	const std::vector<int64_t> threads = args.getIntList("threads", "0,1,2,4");
+	const int clientThreads = static_cast<int>(args.getInt("clientThreads", 1));
+	const bool edgeTriggered = args.getInt("et", 0) != 0;
+	uint16_t port = static_cast<uint16_t>(args.getInt("port", 9910));
+
+	raiseFdLimit(2 * numConns + 256);
+
+	BenchReport report("pingpong");
+	report.setParam("conns", numConns);
+	report.setParam("seconds", seconds);
+	report.setParam("clientThreads", clientThreads);
+	report.setParam("et", edgeTriggered ? 1 : 0);
+
+	for (int64_t size : sizes)
+	{
+		for (int64_t numThreads : threads)
+		{
+			//每一轮换一个端口，避免上一轮的连接还没有完全关闭
+			RunResult result = runOnce(port++, numConns, static_cast<size_t>(size), seconds,
+				static_cast<int>(numThreads), clientThreads > 0 ? clientThreads : 1, edgeTriggered);
+			double messages = static_cast<double>(result.bytes) / size;
+			double elapsed = result.seconds > 0 ? result.seconds : 1;
+			fprintf(stderr, "size=%-7ld threads=%-3ld connected=%-6d %12.0f msg/s %10.2f MB/s\n",
+				static_cast<long>(size), static_cast<long>(numThreads), result.connected,
+				messages / elapsed, result.bytes / elapsed / 1024 / 1024);
+
+			report.beginResult();
+			report.add("size", static_cast<double>(size));
+			report.add("threads", static_cast<double>(numThreads));
+			report.add("connected", result.connected);
+			report.add("seconds", result.seconds);
+			report.add("bytes", static_cast<double>(result.bytes));
+			report.add("msgPerSec", messages / elapsed);
+			report.add("mbPerSec", result.bytes / elapsed / 1024 / 1024);
+		}
+	}
+	report.write(args);
+	return 0;
+}
@@ -0,0 +1,141 @@
+//跨线程queueInLoop的吞吐量测试
+//1到32个生产者线程同时向同一个loop投递回调，统计loop每秒执行的回调数
+//  mutex: 原来的实现，互斥锁保护vector，每次投递都写一次eventfd
+//  mpsc:  EventLoop::queueInLoop，无锁队列加上合并的唤醒
+//用法: queue_bench [每个生产者投递的回调数] [最多生产者数]
+
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+//原来EventLoop的做法，单独用一个线程模拟loop
+class MutexQueue
+{
+public:
+	using Functor = std::function<void()>;
+
+	MutexQueue() :wakeupFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), quit_(false)
+	{
+		thread_ = std::thread(std::bind(&MutexQueue::loop, this));
+	}
+
+	~MutexQueue()
+	{
+		queue([this]() { quit_ = true; });
+		thread_.join();
+		::close(wakeupFd_);
+	}
+
+	void queue(Functor cb)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			pending_.emplace_back(std::move(cb));
+		}
+		uint64_t one = 1;
+		if (::write(wakeupFd_, &one, sizeof one) != sizeof one)
+		{
+			perror("write");
+		}
+	}
+
+private:
+	void loop()
+	{
+		while (!quit_)
+		{
+			struct pollfd pfd = { wakeupFd_, POLLIN, 0 };
+			::poll(&pfd, 1, 1000);
+			uint64_t one;
+			if (::read(wakeupFd_, &one, sizeof one) < 0)
+			{
+				continue;
+			}
+			std::vector<Functor> functors;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				functors.swap(pending_);
+			}
+			for (const Functor& functor : functors)
+			{
+				functor();
+			}
+		}
+	}
+
+	int wakeupFd_;
+	std::atomic<bool> quit_;
+	std::mutex mutex_;
+	std::vector<Functor> pending_;
+	std::thread thread_;
+};
+
+//numProducers个线程各投递perProducer个回调，返回每秒执行的回调数
+template<typename QueueFunc>
+static double run(int numProducers, int64_t perProducer, QueueFunc queueFunc)
+{
+	const int64_t total = numProducers * perProducer;
+	int64_t executed = 0;	//只在loop线程中修改
+	std::atomic<bool> done(false);
+
+	Timestamp start(Timestamp::now());
+	std::vector<std::thread> producers;
+	for (int i = 0; i < numProducers; i++)
+	{
+		producers.push_back(std::thread([&]() {
+			for (int64_t j = 0; j < perProducer; j++)
+			{
+				queueFunc([&]() {
+					if (++executed == total)
+					{
+						done = true;
+					}
+				});
+			}
+		}));
+	}
+	for (std::thread& t : producers)
+	{
+		t.join();
+	}
+	while (!done)
+	{
+		::usleep(100);
+	}
+	return total / timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char* argv[])
+{
+	const int64_t perProducer = argc > 1 ? atol(argv[1]) : 200000;
+	const int maxProducers = argc > 2 ? atoi(argv[2]) : 32;
+	Logger::setLogLevel(ERROR);
+
+	EventLoopThread loopThread;
+	EventLoop* loop = loopThread.startLoop();
+
+	printf("%-10s %15s %15s\n", "producers", "mutex tasks/s", "mpsc tasks/s");
+	for (int producers = 1; producers <= maxProducers; producers *= 2)
+	{
+		double mutexRate = 0;
+		{
+			MutexQueue queue;
+			mutexRate = run(producers, perProducer, [&](MutexQueue::Functor cb) { queue.queue(std::move(cb)); });
+		}
+		double mpscRate = run(producers, perProducer, [&](EventLoop::Functor cb) { loop->queueInLoop(std::move(cb)); });
+		printf("%-10d %15.0f %15.0f\n", producers, mutexRate, mpscRate);
+	}
+	return 0;
+}
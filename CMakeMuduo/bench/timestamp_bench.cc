@@ -0,0 +1,79 @@
+//Timestamp的微基准 取时间和格式化的开销
+//formatTo同一秒内只重新格式化微秒部分，toString/toFormattedString每次都分配string
+//用法: timestamp_bench [通用参数，见BenchCommon.h的MicroBench]
+
+#include "BenchCommon.h"
+#include "Timestamp.h"
+
+#include <time.h>
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	MicroBench bench("timestamp", args);
+
+	bench.run("clock_gettime REALTIME", [](int64_t n) {
+		struct timespec ts;
+		for (int64_t i = 0; i < n; i++)
+		{
+			::clock_gettime(CLOCK_REALTIME, &ts);
+			doNotOptimize(ts);
+		}
+	});
+	bench.run("Timestamp::now", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(Timestamp::now());
+		}
+	});
+	bench.run("Timestamp::monotonic", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(Timestamp::monotonic());
+		}
+	});
+
+	//固定的时间，只测格式化
+	Timestamp fixed(Timestamp::now());
+	bench.run("toString", [fixed](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			std::string s = fixed.toString();
+			doNotOptimize(s.data());
+		}
+	});
+	bench.run("toFormattedString", [fixed](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			std::string s = fixed.toFormattedString();
+			doNotOptimize(s.data());
+		}
+	});
+	bench.run("formatTo same second", [fixed](int64_t n) {
+		char buf[64];
+		int64_t second = fixed.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond * Timestamp::kMicroSecondsPerSecond;
+		for (int64_t i = 0; i < n; i++)
+		{
+			Timestamp t(second + i % Timestamp::kMicroSecondsPerSecond);
+			doNotOptimize(t.formatTo(buf, sizeof buf));
+		}
+	});
+	bench.run("formatTo new second", [fixed](int64_t n) {
+		char buf[64];
+		for (int64_t i = 0; i < n; i++)
+		{
+			Timestamp t(fixed.microSecondsSinceEpoch() + i * Timestamp::kMicroSecondsPerSecond);
+			doNotOptimize(t.formatTo(buf, sizeof buf));
+		}
+	});
+	bench.run("now + formatTo", [](int64_t n) {
+		char buf[64];
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(Timestamp::now().formatTo(buf, sizeof buf));
+		}
+	});
+
+	bench.finish();
+	return 0;
+}
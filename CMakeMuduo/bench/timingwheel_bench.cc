@@ -0,0 +1,113 @@
+//时间轮空闲检测的开销测试
+//模拟100万个连接，随机的连接收到消息，对比每条消息的开销：
+//  wheel: TimingWheel::Entry::touch
+//  heap:  每条消息取消旧的定时器再runAfter一个新的
+//用法: timingwheel_bench [连接数] [消息数]
+
+#include "EventLoop.h"
+#include "TimingWheel.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <random>
+
+//TimingWheel::tick是私有的，测试时直接推进，不等定时器
+struct TimingWheelBench
+{
+	static void tick(TimingWheel& wheel) { wheel.tick(); }
+};
+
+static double elapsedSeconds(Timestamp start)
+{
+	return timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t numConns = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1000000;
+	const size_t numMessages = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 10000000;
+	const double idleTimeout = 60.0;
+
+	EventLoop loop;
+	std::mt19937 rng(12345);
+	std::vector<uint32_t> targets(numMessages);
+	for (size_t i = 0; i < numMessages; i++)
+	{
+		targets[i] = static_cast<uint32_t>(rng() % numConns);
+	}
+
+	//时间轮
+	{
+		TimingWheel wheel(&loop, 1.0);
+		std::unique_ptr<TimingWheel::Entry[]> entries(new TimingWheel::Entry[numConns]);
+		size_t expired = 0;
+
+		Timestamp start(Timestamp::now());
+		for (size_t i = 0; i < numConns; i++)
+		{
+			entries[i].setExpireCallback([&expired]() { ++expired; });
+			wheel.add(&entries[i], idleTimeout);
+		}
+		double addTime = elapsedSeconds(start);
+
+		//每个tick之间有numMessages/90条消息，一共推进90个tick，没有消息的连接会在第60个tick超时
+		const size_t ticks = 90;
+		const size_t perTick = numMessages / ticks;
+		double touchTime = 0.0;
+		double tickTime = 0.0;
+		size_t msg = 0;
+		for (size_t t = 0; t < ticks; t++)
+		{
+			start = Timestamp::now();
+			for (size_t i = 0; i < perTick; i++, msg++)
+			{
+				entries[targets[msg]].touch();
+			}
+			touchTime += elapsedSeconds(start);
+
+			start = Timestamp::now();
+			TimingWheelBench::tick(wheel);
+			tickTime += elapsedSeconds(start);
+		}
+
+		printf("wheel: conns=%zu messages=%zu\n", numConns, msg);
+		printf("  add    %.1f ns/conn\n", addTime * 1e9 / numConns);
+		printf("  touch  %.2f ns/message\n", touchTime * 1e9 / msg);
+		printf("  tick   %.3f ms/tick, %zu expired, %zu still active\n",
+			tickTime * 1e3 / ticks, expired, wheel.size());
+	}
+
+	//最小堆定时器 每条消息都要重新设置一次
+	{
+		const size_t heapMessages = numMessages / 10;
+		std::vector<TimerId> timers(numConns);
+		Timestamp start(Timestamp::now());
+		for (size_t i = 0; i < numConns; i++)
+		{
+			timers[i] = loop.runAfter(idleTimeout, []() {});
+		}
+		double addTime = elapsedSeconds(start);
+
+		start = Timestamp::now();
+		for (size_t i = 0; i < heapMessages; i++)
+		{
+			uint32_t conn = targets[i];
+			loop.cancel(timers[conn]);
+			timers[conn] = loop.runAfter(idleTimeout, []() {});
+		}
+		double touchTime = elapsedSeconds(start);
+
+		printf("heap: conns=%zu messages=%zu\n", numConns, heapMessages);
+		printf("  add    %.1f ns/conn\n", addTime * 1e9 / numConns);
+		printf("  reset  %.2f ns/message\n", touchTime * 1e9 / heapMessages);
+
+		for (size_t i = 0; i < numConns; i++)
+		{
+			loop.cancel(timers[i]);
+		}
+	}
+	return 0;
+}
\ No newline at end of file
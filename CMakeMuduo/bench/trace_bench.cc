@@ -0,0 +1,78 @@
+//Tracer的微基准 每个跟踪点的开销
+//  disabled: 没有打开跟踪，只有一次relaxed读和分支
+//  enabled: 写入当前线程的环形缓冲区，包括取ticks
+//  export: 导出一个写满的缓冲区为Chrome trace，每次操作是一次完整的导出，除以records得到每条记录的开销
+//用法: trace_bench [通用参数，见BenchCommon.h的MicroBench] [records=65536] [out=导出的文件]
+
+#include "BenchCommon.h"
+#include "Tracer.h"
+
+#include <stdio.h>
+
+int main(int argc, char* argv[])
+{
+	BenchArgs args(argc, argv);
+	MicroBench bench("trace", args);
+	size_t records = static_cast<size_t>(args.getInt("records", static_cast<int64_t>(Tracer::kDefaultRecordsPerThread)));
+
+	Tracer::disable();
+	bench.run("TraceScope disabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			TraceScope trace("bench", i);
+			trace.setResult(i);
+		}
+	});
+	bench.run("instant disabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			Tracer::instant("bench", i);
+		}
+	});
+
+	Tracer::enable(records);
+	bench.run("Tracer::ticks", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			doNotOptimize(Tracer::ticks());
+		}
+	});
+	//一个作用域是两条记录
+	bench.run("TraceScope enabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			TraceScope trace("bench", i);
+			trace.setResult(i);
+		}
+	});
+	bench.run("instant enabled", [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			Tracer::instant("bench", i);
+		}
+	});
+
+	//先写满缓冲区，每次导出的记录数固定
+	for (size_t i = 0; i < records; i++)
+	{
+		Tracer::instant("bench", static_cast<int64_t>(i));
+	}
+	char exportCase[64];
+	snprintf(exportCase, sizeof exportCase, "toChromeTrace per export (%zu records)", records);
+	bench.run(exportCase, [](int64_t n) {
+		for (int64_t i = 0; i < n; i++)
+		{
+			std::string trace = Tracer::toChromeTrace();
+			doNotOptimize(trace.data());
+		}
+	});
+	Tracer::disable();
+
+	std::string out = args.getString("out", "");
+	if (!out.empty())
+	{
+		Tracer::writeChromeTrace(out);
+	}
+	bench.finish();
+	return 0;
+}
@@ -0,0 +1,101 @@
+// 类似top，显示一个进程里各个EventLoop的运行统计
+// 进程用MetricsShm定时发布统计，这里只读映射共享内存，不和进程通信
+// 用法: looptop [共享内存名字，默认/mymuduo-testserver] [刷新间隔秒数，默认1]
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include <mymuduo/MetricsShm.h>
+#include <mymuduo/Timestamp.h>
+
+// 两次发布之间的直方图，只有桶和计数可以相减
+static LoopMetrics::Histogram delta(const LoopMetrics::Histogram& cur, const LoopMetrics::Histogram& prev)
+{
+    LoopMetrics::Histogram h = cur;
+    for (int i = 0; i < LoopMetrics::kBuckets; i++)
+    {
+        h.buckets[i] -= prev.buckets[i];
+    }
+    h.count -= prev.count;
+    h.sum -= prev.sum;
+    return h;
+}
+
+static void printLoop(const char* name, const LoopMetrics::Snapshot& cur, const LoopMetrics::Snapshot& prev, double seconds)
+{
+    LoopMetrics::Histogram iteration = delta(cur.iterationMicros, prev.iterationMicros);
+    LoopMetrics::Histogram functors = delta(cur.functorsPerRound, prev.functorsPerRound);
+    printf("%-6s %8lld %10.0f %10.0f %10.0f %6.1f %10.2f %10.2f %8lld %8lld %8lld\n",
+        name,
+        static_cast<long long>(cur.connections),
+        (cur.iterations - prev.iterations) / seconds,
+        (cur.events - prev.events) / seconds,
+        (cur.functors - prev.functors) / seconds,
+        (cur.busyMicroSeconds - prev.busyMicroSeconds) / seconds / 1e4,
+        (cur.bytesIn - prev.bytesIn) / seconds / 1024 / 1024,
+        (cur.bytesOut - prev.bytesOut) / seconds / 1024 / 1024,
+        static_cast<long long>(iteration.percentile(0.5)),
+        static_cast<long long>(iteration.percentile(0.99)),
+        static_cast<long long>(functors.percentile(0.99)));
+}
+
+int main(int argc, char* argv[])
+{
+    std::string name = argc > 1 ? argv[1] : "/mymuduo-testserver";
+    double interval = argc > 2 ? atof(argv[2]) : 1.0;
+    if (interval <= 0)
+    {
+        interval = 1.0;
+    }
+
+    MetricsShm::Header header;
+    std::vector<LoopMetrics::Snapshot> prev;
+    int64_t prevMicros = 0;
+    for (;;)
+    {
+        std::vector<LoopMetrics::Snapshot> cur;
+        if (!MetricsShm::read(name, &header, &cur))
+        {
+            fprintf(stderr, "cannot read %s\n", name.c_str());
+            return 1;
+        }
+
+        // 进程还没有发布新的数据，或者loop个数变了，重新开始计算差值
+        if (header.publishMicros != prevMicros && prev.size() == cur.size() && prevMicros > 0)
+        {
+            double seconds = (header.publishMicros - prevMicros) / 1e6;
+            printf("\033[H\033[2J");
+            printf("pid %d  loops %d  published %s\n\n", header.pid, header.numLoops,
+                Timestamp(header.publishMicros).toFormattedString(false).c_str());
+            printf("%-6s %8s %10s %10s %10s %6s %10s %10s %8s %8s %8s\n", "LOOP", "CONNS", "ITER/s", "EVENTS/s",
+                "FUNCS/s", "BUSY%", "IN MB/s", "OUT MB/s", "P50(us)", "P99(us)", "QUEUE99");
+            LoopMetrics::Snapshot total = cur[0];
+            LoopMetrics::Snapshot prevTotal = prev[0];
+            for (size_t i = 0; i < cur.size(); i++)
+            {
+                char loopName[16];
+                snprintf(loopName, sizeof loopName, "%zu", i);
+                printLoop(loopName, cur[i], prev[i], seconds);
+                if (i > 0)
+                {
+                    total.merge(cur[i]);
+                    prevTotal.merge(prev[i]);
+                }
+            }
+            if (cur.size() > 1)
+            {
+                printLoop("total", total, prevTotal, seconds);
+            }
+            fflush(stdout);
+        }
+        if (header.publishMicros != prevMicros)
+        {
+            prev.swap(cur);
+            prevMicros = header.publishMicros;
+        }
+        usleep(static_cast<useconds_t>(interval * 1e6));
+    }
+    return 0;
+}
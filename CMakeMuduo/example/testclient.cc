@@ -0,0 +1,60 @@
+#include <string>
+
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/Logger.h>
+
+class EchoClient
+{
+public:
+    EchoClient(EventLoop* loop, const InetAddress& addr, const std::string& name)
+        : client_(loop, addr, name)
+        , loop_(loop)
+    {
+        // 注册回调函数
+        client_.setConnectionCallback(
+            std::bind(&EchoClient::onConnection, this, std::placeholders::_1));
+
+        client_.setMessageCallback(
+            std::bind(&EchoClient::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+        // 连接断开之后自动重连
+        client_.enableRetry();
+    }
+    void connect()
+    {
+        client_.connect();
+    }
+
+private:
+    // 连接建立或断开的回调函数
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            LOG_INFO("Connection UP : %s\n", conn->peerAddress().toIpPort().c_str());
+            conn->send("hello\n");
+        }
+        else
+        {
+            LOG_INFO("Connection DOWN : %s\n", conn->peerAddress().toIpPort().c_str());
+        }
+    }
+
+    // 收到服务器回显的数据，再发回去
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp time)
+    {
+        conn->send(buf);
+    }
+    TcpClient client_;
+    EventLoop* loop_;
+
+};
+
+int main() {
+    EventLoop loop;
+    InetAddress addr(8080);
+    EchoClient client(&loop, addr, "EchoClient");
+    client.connect();
+    loop.loop();
+    return 0;
+}
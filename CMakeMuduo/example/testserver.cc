@@ -1,6 +1,8 @@
 #include <string>
 
 #include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoopThreadPool.h>
+#include <mymuduo/MetricsShm.h>
 #include <mymuduo/Logger.h>
 
 class EchoServer
@@ -9,6 +11,7 @@ public:
     EchoServer(EventLoop* loop, const InetAddress& addr, const std::string& name)
         : server_(loop, addr, name)
         , loop_(loop)
+        , metrics_("/mymuduo-testserver")
     {
         // 注册回调函数
         server_.setConnectionCallback(
@@ -23,6 +26,10 @@ public:
     void start()
     {
         server_.start();
+
+        // 每秒把各个subloop的统计发布到共享内存，用looptop查看
+        loops_ = server_.threadPool()->getAllLoops();
+        loop_->runEvery(1.0, [this]() { metrics_.publish(loops_); });
     }
 
 private:
@@ -42,12 +49,13 @@ private:
     // 可读写事件回调
     void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp time)
     {
-        std::string msg = buf->retrieveAllAsString();
-        conn->send(msg);
+        conn->send(buf);
         //conn->shutdown();   // 关闭写端 底层响应EPOLLHUP => 执行closeCallback_
     }
     TcpServer server_;
     EventLoop* loop_;
+    MetricsShm metrics_;
+    std::vector<EventLoop*> loops_;
 
 };
 